@@ -0,0 +1,339 @@
+/**
+ * Copyright (c) 2021 Melown Technologies SE
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * *  Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * *  Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <cerrno>
+#include <mutex>
+#include <thread>
+#include <stdexcept>
+#include <typeinfo>
+#include <vector>
+
+#include <boost/asio.hpp>
+#include <boost/format.hpp>
+#include <boost/optional.hpp>
+#include <boost/utility/in_place_factory.hpp>
+
+#ifdef VTSD_HAS_LIBURING
+#  include <liburing.h>
+#endif
+
+#include "dbglog/dbglog.hpp"
+
+#include "asyncreader.hpp"
+
+#ifdef VTSD_HAS_LIBURING
+
+namespace asio = boost::asio;
+
+namespace {
+
+struct Request {
+    int fd;
+    std::size_t offset;
+    std::size_t done;
+    std::string data;
+    AsyncReader::Callback callback;
+
+    Request(int fd, std::size_t offset, std::size_t size
+            , const AsyncReader::Callback &callback)
+        : fd(fd), offset(offset), done(), data(size, '\0')
+        , callback(callback)
+    {}
+};
+
+} // namespace
+
+struct AsyncReader::Detail {
+    Detail(unsigned int queueDepth, std::size_t dispatcherCount);
+    ~Detail();
+
+    bool read(int fd, std::size_t offset, std::size_t size
+              , const Callback &callback);
+
+    void stop();
+
+private:
+    /** Gets submission queue entry. Must be called under lock.
+     */
+    ::io_uring_sqe* sqe();
+
+    /** (Re)submits request.
+     */
+    void submit(Request *request);
+
+    /** Finishes request: hands it over to dispatchers. Returns true if
+     *  completion thread should terminate.
+     */
+    bool finish(Request *request, const std::error_code &ec);
+
+    void run();
+
+    void dispatcher(std::size_t id);
+
+public:
+    bool available;
+
+private:
+    ::io_uring ring_;
+
+    /** Protects submission side of ring and inflight_/stopping_.
+     */
+    std::mutex mutex_;
+    std::size_t inflight_;
+    bool stopping_;
+
+    /** Serializes stop() calls.
+     */
+    std::mutex stopMutex_;
+    bool stopped_;
+
+    std::thread completion_;
+
+    /** Callback dispatching.
+     */
+    asio::io_service ios_;
+    boost::optional<asio::io_service::work> work_;
+    std::vector<std::thread> dispatchers_;
+};
+
+AsyncReader::Detail::Detail(unsigned int queueDepth
+                            , std::size_t dispatcherCount)
+    : available(false), inflight_(0), stopping_(false), stopped_(false)
+{
+    const auto res(::io_uring_queue_init(queueDepth, &ring_, 0));
+    if (res < 0) {
+        std::system_error e(-res, std::system_category());
+        LOG(warn3)
+            << "Cannot initialize io_uring: <" << e.code() << ", "
+            << e.what() << ">; falling back to blocking reads.";
+        return;
+    }
+
+    available = true;
+
+    work_ = boost::in_place(std::ref(ios_));
+    if (!dispatcherCount) { dispatcherCount = 1; }
+    for (std::size_t id(1); id <= dispatcherCount; ++id) {
+        dispatchers_.emplace_back(&Detail::dispatcher, this, id);
+    }
+
+    completion_ = std::thread(&Detail::run, this);
+    LOG(info3) << "Using io_uring for local file reads (queue depth: "
+               << queueDepth << ", dispatchers: " << dispatcherCount << ").";
+}
+
+AsyncReader::Detail::~Detail()
+{
+    stop();
+}
+
+void AsyncReader::Detail::stop()
+{
+    if (!available) { return; }
+
+    std::lock_guard<std::mutex> stopGuard(stopMutex_);
+    if (stopped_) { return; }
+    stopped_ = true;
+
+    {
+        // refuse new reads and wake up completion thread by no-op without
+        // user data
+        std::lock_guard<std::mutex> guard(mutex_);
+        stopping_ = true;
+        auto *e(sqe());
+        ::io_uring_prep_nop(e);
+        ::io_uring_sqe_set_data(e, nullptr);
+        ::io_uring_submit(&ring_);
+    }
+
+    completion_.join();
+    ::io_uring_queue_exit(&ring_);
+
+    // let dispatchers run all pending callbacks and terminate
+    work_ = boost::none;
+    while (!dispatchers_.empty()) {
+        dispatchers_.back().join();
+        dispatchers_.pop_back();
+    }
+}
+
+::io_uring_sqe* AsyncReader::Detail::sqe()
+{
+    for (;;) {
+        if (auto *e = ::io_uring_get_sqe(&ring_)) { return e; }
+        // submission queue is full, flush it to the kernel and try again
+        ::io_uring_submit(&ring_);
+    }
+}
+
+void AsyncReader::Detail::submit(Request *request)
+{
+    std::lock_guard<std::mutex> guard(mutex_);
+    auto *e(sqe());
+    ::io_uring_prep_read(e, request->fd, &request->data[request->done]
+                         , request->data.size() - request->done
+                         , request->offset + request->done);
+    ::io_uring_sqe_set_data(e, request);
+    ::io_uring_submit(&ring_);
+}
+
+bool AsyncReader::Detail::read(int fd, std::size_t offset, std::size_t size
+                               , const Callback &callback)
+{
+    std::unique_ptr<Request> request
+        (new Request(fd, offset, size, callback));
+    {
+        // NB: completion thread (and ring) lives until inflight_ drops to
+        // zero, i.e. accepted read is always finished
+        std::lock_guard<std::mutex> guard(mutex_);
+        if (stopping_) { return false; }
+        ++inflight_;
+    }
+    submit(request.release());
+    return true;
+}
+
+bool AsyncReader::Detail::finish(Request *request, const std::error_code &ec)
+{
+    std::shared_ptr<Request> r(request);
+    r->data.resize(r->done);
+
+    ios_.post([r, ec]()
+    {
+        try {
+            r->callback(ec, r->data);
+        } catch (const std::exception &e) {
+            LOG(err3)
+                << "Uncaught exception (" << typeid(e).name()
+                << ") in asynchronous read callback: <" << e.what()
+                << ">. Going on.";
+        }
+    });
+
+    std::lock_guard<std::mutex> guard(mutex_);
+    --inflight_;
+    return (stopping_ && !inflight_);
+}
+
+void AsyncReader::Detail::run()
+{
+    dbglog::thread_id("aio");
+    LOG(info2) << "Spawned asynchronous I/O completion thread.";
+
+    for (;;) {
+        ::io_uring_cqe *cqe;
+        const auto res(::io_uring_wait_cqe(&ring_, &cqe));
+        if (res < 0) {
+            if (res == -EINTR) { continue; }
+            std::system_error e(-res, std::system_category());
+            LOG(err3) << "Waiting for io_uring completion failed: <"
+                      << e.code() << ", " << e.what() << ">.";
+            continue;
+        }
+
+        auto *request(static_cast<Request*>(::io_uring_cqe_get_data(cqe)));
+        const auto result(cqe->res);
+        ::io_uring_cqe_seen(&ring_, cqe);
+
+        if (!request) {
+            // wake-up call
+            std::lock_guard<std::mutex> guard(mutex_);
+            if (stopping_ && !inflight_) { break; }
+            continue;
+        }
+
+        if (result < 0) {
+            if ((result == -EAGAIN) || (result == -EINTR)) {
+                submit(request);
+                continue;
+            }
+
+            if (finish(request, std::error_code
+                       (-result, std::system_category())))
+            {
+                break;
+            }
+            continue;
+        }
+
+        request->done += result;
+        if (result && (request->done < request->data.size())) {
+            // short read, read the rest
+            submit(request);
+            continue;
+        }
+
+        // done or EOF
+        if (finish(request, {})) { break; }
+    }
+
+    LOG(info2) << "Terminated asynchronous I/O completion thread.";
+}
+
+void AsyncReader::Detail::dispatcher(std::size_t id)
+{
+    dbglog::thread_id(str(boost::format("aio:%u") % id));
+    ios_.run();
+}
+
+#else // VTSD_HAS_LIBURING
+
+struct AsyncReader::Detail {
+    Detail(unsigned int, std::size_t) : available(false) {
+        LOG(info3) << "Compiled without io_uring support; "
+            "using blocking reads.";
+    }
+
+    bool read(int, std::size_t, std::size_t, const Callback&) {
+        return false;
+    }
+
+    void stop() {}
+
+    bool available;
+};
+
+#endif // VTSD_HAS_LIBURING
+
+AsyncReader::AsyncReader(unsigned int queueDepth
+                         , std::size_t dispatcherCount)
+    : detail_(new Detail(queueDepth, dispatcherCount))
+{}
+
+AsyncReader::~AsyncReader() {}
+
+bool AsyncReader::available() const { return detail_->available; }
+
+bool AsyncReader::read(int fd, std::size_t offset, std::size_t size
+                       , const Callback &callback)
+{
+    return detail_->read(fd, offset, size, callback);
+}
+
+void AsyncReader::stop()
+{
+    detail_->stop();
+}
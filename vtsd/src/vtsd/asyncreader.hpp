@@ -0,0 +1,95 @@
+/**
+ * Copyright (c) 2021 Melown Technologies SE
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * *  Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * *  Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef vtsd_asyncreader_hpp_included_
+#define vtsd_asyncreader_hpp_included_
+
+#include <string>
+#include <memory>
+#include <functional>
+#include <system_error>
+
+#include <boost/noncopyable.hpp>
+
+/** Asynchronous reader of local files.
+ *
+ *  Reads are submitted to an io_uring ring and reaped by a single completion
+ *  thread; no HTTP or core thread is blocked by slow storage. Completion
+ *  callbacks are run by a pool of dispatcher threads so that one slow callback
+ *  does not hold up reaping of other reads.
+ *
+ *  NB: callbacks do not run on the event loop of the requesting HTTP thread:
+ *  libhttp does not expose its server loop. This is fine since sinks can be
+ *  used from any thread (just like from delivery cache workers).
+ *
+ *  If io_uring is not available (not compiled in or refused by kernel)
+ *  available() returns false and callers are expected to use regular blocking
+ *  reads.
+ */
+class AsyncReader : boost::noncopyable {
+public:
+    /** Completion handler. Receives read data on success.
+     */
+    typedef std::function<void(const std::error_code &ec, std::string &data)>
+        Callback;
+
+    /** Creates reader with ring of given queue depth and given number of
+     *  callback dispatcher threads.
+     */
+    AsyncReader(unsigned int queueDepth, std::size_t dispatcherCount);
+    ~AsyncReader();
+
+    /** Is asynchronous I/O available?
+     */
+    bool available() const;
+
+    /** Reads size bytes at given offset from file descriptor. Caller must keep
+     *  file descriptor open until callback is called. Short read (i.e. EOF)
+     *  is not an error, data are truncated.
+     *
+     *  Callback is called in one of dispatcher threads.
+     *
+     *  Returns false if read has not been accepted (reader is not available
+     *  or is being stopped); callback is never called in that case and the
+     *  caller is expected to fall back to regular blocking read.
+     */
+    bool read(int fd, std::size_t offset, std::size_t size
+              , const Callback &callback);
+
+    /** Stops reader: no new read is accepted, in-flight reads are finished
+     *  and their callbacks run. Blocks until done. Called from destructor as
+     *  well; must be called while read() can still be called by other
+     *  threads since destructor cannot protect them.
+     */
+    void stop();
+
+    struct Detail;
+
+private:
+    std::unique_ptr<Detail> detail_;
+};
+
+#endif // vtsd_asyncreader_hpp_included_
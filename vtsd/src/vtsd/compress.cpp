@@ -0,0 +1,210 @@
+/**
+ * Copyright (c) 2021 Melown Technologies SE
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * *  Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * *  Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <zlib.h>
+
+#ifdef VTSD_HAS_LIBDEFLATE
+#  include <libdeflate.h>
+#endif
+
+#include <memory>
+
+#include <boost/lexical_cast.hpp>
+
+#include "dbglog/dbglog.hpp"
+
+#include "utility/format.hpp"
+
+#include "error.hpp"
+#include "compress.hpp"
+
+namespace po = boost::program_options;
+
+void CompressionConfig::configuration(po::options_description &od
+                                      , const std::string &prefix)
+{
+    od.add_options()
+        ((prefix + "compressor").c_str()
+         , po::value(&compressor)->default_value(compressor)->required()
+         , utility::format("Compression backend used for generated content"
+                           ", one of {%s}.", enumerationString(Compressor()))
+         .c_str())
+        ((prefix + "compressionLevel").c_str()
+         , po::value(&level)->default_value(level)->required()
+         , "Compression level of generated content: 0-9 for zlib, "
+         "0-12 for libdeflate.")
+        ;
+}
+
+void CompressionConfig::configure(const po::variables_map&
+                                  , const std::string &prefix)
+{
+    if ((compressor == Compressor::libdeflate) && !libdeflateAvailable()) {
+        LOG(warn3) << "Compiled without libdeflate support; "
+                   << "falling back to zlib.";
+        compressor = Compressor::zlib;
+        if (level > 9) { level = 9; }
+    }
+
+    const int maxLevel((compressor == Compressor::libdeflate) ? 12 : 9);
+    if ((level < 0) || (level > maxLevel)) {
+        throw po::validation_error
+            (po::validation_error::invalid_option_value
+             , prefix + "compressionLevel"
+             , boost::lexical_cast<std::string>(level));
+    }
+}
+
+std::ostream& CompressionConfig::dump(std::ostream &os
+                                      , const std::string &prefix) const
+{
+    os << prefix << "compressor = " << compressor << "\n"
+       << prefix << "compressionLevel = " << level << "\n";
+    return os;
+}
+
+namespace {
+
+std::string zlibGzip(const char *data, std::size_t size, int level)
+{
+    ::z_stream zs{};
+    // 15 + 16: max window, gzip wrapper
+    if (::deflateInit2(&zs, level, Z_DEFLATED, 15 + 16, 8
+                       , Z_DEFAULT_STRATEGY) != Z_OK)
+    {
+        LOGTHROW(err2, InternalError) << "Cannot initialize zlib deflate.";
+    }
+    std::shared_ptr<::z_stream> guard(&zs, [](::z_stream *zs) {
+            ::deflateEnd(zs);
+        });
+
+    std::string out(::deflateBound(&zs, size), '\0');
+    zs.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data));
+    zs.avail_in = size;
+    zs.next_out = reinterpret_cast<Bytef*>(&out[0]);
+    zs.avail_out = out.size();
+
+    if (::deflate(&zs, Z_FINISH) != Z_STREAM_END) {
+        LOGTHROW(err2, InternalError) << "zlib deflate failed.";
+    }
+
+    out.resize(zs.total_out);
+    return out;
+}
+
+#ifdef VTSD_HAS_LIBDEFLATE
+
+std::string libdeflateGzip(const char *data, std::size_t size, int level)
+{
+    // compressors are not thread-safe but cheap to keep per thread and level
+    struct Compressors {
+        ::libdeflate_compressor *byLevel[13] = {};
+
+        ~Compressors() {
+            for (auto *compressor : byLevel) {
+                if (compressor) { ::libdeflate_free_compressor(compressor); }
+            }
+        }
+    };
+    thread_local Compressors compressors;
+
+    auto *&compressor(compressors.byLevel[level]);
+    if (!compressor) {
+        compressor = ::libdeflate_alloc_compressor(level);
+        if (!compressor) {
+            LOGTHROW(err2, InternalError)
+                << "Cannot allocate libdeflate compressor.";
+        }
+    }
+
+    std::string out
+        (::libdeflate_gzip_compress_bound(compressor, size), '\0');
+    const auto written(::libdeflate_gzip_compress
+                       (compressor, data, size, &out[0], out.size()));
+    if (!written) {
+        LOGTHROW(err2, InternalError) << "libdeflate compression failed.";
+    }
+
+    out.resize(written);
+    return out;
+}
+
+#endif // VTSD_HAS_LIBDEFLATE
+
+} // namespace
+
+bool libdeflateAvailable()
+{
+#ifdef VTSD_HAS_LIBDEFLATE
+    return true;
+#else
+    return false;
+#endif
+}
+
+std::string gzip(const char *data, std::size_t size
+                 , const CompressionConfig &config)
+{
+#ifdef VTSD_HAS_LIBDEFLATE
+    if (config.compressor == Compressor::libdeflate) {
+        return libdeflateGzip(data, size, config.level);
+    }
+#endif
+
+    return zlibGzip(data, size, config.level);
+}
+
+std::string gunzip(const std::string &data)
+{
+    ::z_stream zs{};
+    // 15 + 16: max window, gzip wrapper only
+    if (::inflateInit2(&zs, 15 + 16) != Z_OK) {
+        LOGTHROW(err2, InternalError) << "Cannot initialize zlib inflate.";
+    }
+    std::shared_ptr<::z_stream> guard(&zs, [](::z_stream *zs) {
+            ::inflateEnd(zs);
+        });
+
+    zs.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data.data()));
+    zs.avail_in = data.size();
+
+    std::string out;
+    char buf[1 << 16];
+    for (;;) {
+        zs.next_out = reinterpret_cast<Bytef*>(buf);
+        zs.avail_out = sizeof(buf);
+
+        const auto res(::inflate(&zs, Z_NO_FLUSH));
+        out.append(buf, sizeof(buf) - zs.avail_out);
+
+        if (res == Z_STREAM_END) { break; }
+        if ((res != Z_OK) || (!zs.avail_in && zs.avail_out)) {
+            LOGTHROW(err2, InternalError) << "Invalid gzip data.";
+        }
+    }
+
+    return out;
+}
@@ -0,0 +1,95 @@
+/**
+ * Copyright (c) 2021 Melown Technologies SE
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * *  Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * *  Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef vtsd_compress_hpp_included_
+#define vtsd_compress_hpp_included_
+
+#include <string>
+#include <tuple>
+#include <ostream>
+
+#include <boost/program_options.hpp>
+
+#include "utility/enum-io.hpp"
+
+/** Compression backend used for generated content.
+ */
+UTILITY_GENERATE_ENUM(Compressor,
+                      ((zlib))
+                      ((libdeflate))
+                      )
+
+/** Compression of generated content.
+ */
+struct CompressionConfig {
+    Compressor compressor;
+
+    /** Compression level: 0-9 for zlib, 0-12 for libdeflate.
+     */
+    int level;
+
+    CompressionConfig() : compressor(Compressor::zlib), level(6) {}
+
+    void configuration(boost::program_options::options_description &od
+                       , const std::string &prefix = "");
+
+    void configure(const boost::program_options::variables_map &vars
+                   , const std::string &prefix = "");
+
+    std::ostream& dump(std::ostream &os, const std::string &prefix = "")
+        const;
+
+    bool operator<(const CompressionConfig &o) const {
+        return (std::tie(compressor, level)
+                < std::tie(o.compressor, o.level));
+    }
+
+    bool operator==(const CompressionConfig &o) const {
+        return (std::tie(compressor, level)
+                == std::tie(o.compressor, o.level));
+    }
+};
+
+/** Returns true if libdeflate support has been compiled in.
+ */
+bool libdeflateAvailable();
+
+/** Compresses whole buffer into gzip format in one go.
+ */
+std::string gzip(const char *data, std::size_t size
+                 , const CompressionConfig &config);
+
+inline std::string gzip(const std::string &data
+                        , const CompressionConfig &config)
+{
+    return gzip(data.data(), data.size(), config);
+}
+
+/** Decompresses whole gzip-formatted buffer.
+ */
+std::string gunzip(const std::string &data);
+
+#endif // vtsd_compress_hpp_included_
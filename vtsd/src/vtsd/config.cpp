@@ -29,8 +29,10 @@
 #include "utility/format.hpp"
 
 #include "delivery/vts/po.hpp"
+#include "delivery/vts/batch.hpp"
 
 #include "config.hpp"
+#include "sink.hpp"
 
 namespace po = boost::program_options;
 
@@ -76,8 +78,44 @@ void LocationConfig::configuration(po::options_description &od
          , po::value(&configClass)->default_value(configClass)->required()
          , "Config files (e.g. mapConfig.json, freelayer.json, dirs.json, ...)"
          " file class. Allowed values are \"ephemeral\" and \"config\" only.")
+        ((prefix + "bufferLimit").c_str()
+         , po::value(&bufferLimit)->default_value(bufferLimit)->required()
+         , "Responses up to this size (in bytes) are read into memory "
+         "and the underlying dataset file is released before transmission "
+         "starts, i.e. slow clients do not hold open files. Larger "
+         "responses are streamed. Use 0 to always stream.")
+        ((prefix + "vts.batch").c_str()
+         , po::value(&enableBatch)->default_value(enableBatch)
+         , "Enable batch endpoint for VTS tilesets: "
+         "<dataset>/batch?<file>,<file>,... returns all listed tile files "
+         "in one length-prefixed binary bundle.")
+        ((prefix + "vts.batchLimit").c_str()
+         , po::value(&batchLimit)->default_value(batchLimit)
+         , "Maximum number of files in one batch request (at most 65535).")
+        ((prefix + "vts.readahead").c_str()
+         , po::value(&enableReadahead)->default_value(enableReadahead)
+         , "Whenever a metatile is served, ask the OS to read ahead meshes "
+         "and atlases of real nodes it lists. Applicable only to datasets "
+         "stored in local files.")
+        ((prefix + "3dtiles.implicit").c_str()
+         , po::value(&enableImplicitTiling)
+         ->default_value(enableImplicitTiling)
+         , "Serve VTS tilesets as 3D Tiles 1.1 implicit tileset (quadtree "
+         "subtree files) instead of explicit tileset JSON hierarchy.")
+        ((prefix + "3dtiles.content").c_str()
+         , po::value(&tdtContent)->default_value(tdtContent)->required()
+         , utility::format("3D Tiles mesh content format, one of {%s}. "
+                           "GLB (binary glTF) requires 3D Tiles 1.1 client."
+                           , enumerationString(TdtContent())).c_str())
+        ((prefix + "3dtiles.embedTextures").c_str()
+         , po::value(&tdtEmbedTextures)->default_value(tdtEmbedTextures)
+         , "Embed atlas textures into 3D Tiles mesh content instead of "
+         "referencing them by URI. Applicable only to GLB content.")
         ;
 
+    // configure compression of generated content
+    compression.configuration(od, prefix);
+
     // configure variables
     varsConfiguration(od, prefix, vars);
 
@@ -169,6 +207,54 @@ void LocationConfig::configure(const po::variables_map &vars
              , prefix + "configClass"
              , boost::lexical_cast<std::string>(configClass));
     }
+
+    // batch entry count is serialized as uint16
+    if (batchLimit > TileBatch::maxCount) {
+        throw po::validation_error
+            (po::validation_error::invalid_option_value
+             , prefix + "vts.batchLimit"
+             , boost::lexical_cast<std::string>(batchLimit));
+    }
+
+    // textures can be embedded only in GLB
+    if (tdtEmbedTextures && (tdtContent != TdtContent::glb)) {
+        throw po::validation_error
+            (po::validation_error::invalid_option_value
+             , prefix + "3dtiles.embedTextures"
+             , "true");
+    }
+
+    compression.configure(vars, prefix);
+
+    expandSupportFiles();
+}
+
+void LocationConfig::expandSupportFiles()
+{
+    const auto now(std::time(nullptr));
+
+    auto expanded(std::make_shared<ExpandedSupportFile::map>());
+    for (const auto *files : templateSupportFiles()) {
+        for (const auto &item : *files) {
+            const auto &file(item.second);
+            if (!file.isTemplate) { continue; }
+
+            auto &ex((*expanded)[&file]);
+            ex.data = file.expand(&vars, nullptr);
+            ex.lastModified = now;
+            ex.etag = makeETag(ex.data.data(), ex.data.size());
+        }
+    }
+
+    expandedSupportFiles = expanded;
+}
+
+const ExpandedSupportFile*
+LocationConfig::expanded(const vs::SupportFile &file) const
+{
+    if (!expandedSupportFiles) { return nullptr; }
+    auto f(expandedSupportFiles->find(&file));
+    return ((f == expandedSupportFiles->end()) ? nullptr : &f->second);
 }
 
 std::ostream& LocationConfig::dump(std::ostream &os, const std::string &prefix)
@@ -207,6 +293,22 @@ std::ostream& LocationConfig::dump(std::ostream &os, const std::string &prefix)
     }
 
     os << prefix << "configClass = " << configClass << "\n";
+    os << prefix << "bufferLimit = " << bufferLimit << "\n";
+    if (enableDataset) {
+        os << prefix << "vts.batch = " << enableBatch << "\n";
+        if (enableBatch) {
+            os << prefix << "vts.batchLimit = " << batchLimit << "\n";
+        }
+        os << prefix << "vts.readahead = " << enableReadahead << "\n";
+        os << prefix << "3dtiles.implicit = " << enableImplicitTiling
+           << "\n";
+        os << prefix << "3dtiles.content = " << tdtContent << "\n";
+        if (tdtContent == TdtContent::glb) {
+            os << prefix << "3dtiles.embedTextures = " << tdtEmbedTextures
+               << "\n";
+        }
+        compression.dump(os, prefix);
+    }
     fileClassSettings.dump(os, prefix);
 
     return os;
@@ -27,6 +27,10 @@
 #ifndef vtsd_config_hpp_included_
 #define vtsd_config_hpp_included_
 
+#include <ctime>
+#include <map>
+#include <memory>
+
 #include <boost/optional.hpp>
 #include <boost/filesystem/path.hpp>
 #include <boost/program_options.hpp>
@@ -39,9 +43,26 @@
 
 #include "fileclass.hpp"
 #include "format.hpp"
+#include "compress.hpp"
 
 namespace vs = vtslibs::storage;
 
+/** Template support file expanded with location's variables.
+ */
+struct ExpandedSupportFile {
+    typedef std::map<const vs::SupportFile*, ExpandedSupportFile> map;
+
+    std::string data;
+
+    /** Time of expansion, i.e. time of configuration.
+     */
+    std::time_t lastModified;
+
+    /** Entity tag computed from expanded content.
+     */
+    std::string etag;
+};
+
 struct LocationConfig {
     typedef std::vector<LocationConfig> list;
     typedef boost::match_results<std::string::const_iterator> MatchResult;
@@ -50,6 +71,12 @@ struct LocationConfig {
         prefix, regex
     };
 
+    /** 3D Tiles mesh content format.
+     */
+    enum class TdtContent {
+        b3dm, glb
+    };
+
     std::string location;
     Match match;
     boost::optional<Format> enableDataset = Format::native;
@@ -78,10 +105,57 @@ struct LocationConfig {
      */
     FileClass configClass;
 
+    /** Responses up to this size are read fully into memory and the source
+     *  stream is closed before the response is sent. Larger responses are
+     *  streamed. Zero disables buffering.
+     */
+    std::size_t bufferLimit;
+
+    /** Enables VTS batch endpoint (<dataset>/batch?<file>,...).
+     */
+    bool enableBatch;
+
+    /** Maximum number of files in one batch.
+     */
+    std::size_t batchLimit;
+
+    /** Enables readahead of meshes and atlases of real nodes listed in served
+     *  metatiles.
+     */
+    bool enableReadahead;
+
+    /** Serve 3D Tiles tileset using 3D Tiles 1.1 implicit tiling (i.e.
+     *  subtree files instead of metatile JSONs).
+     */
+    bool enableImplicitTiling;
+
+    /** Format of served 3D Tiles mesh content.
+     */
+    TdtContent tdtContent;
+
+    /** Embed atlas textures into 3D Tiles mesh content. Applicable only to
+     *  TdtContent::glb.
+     */
+    bool tdtEmbedTextures;
+
+    /** Compression of generated content (e.g. 3D Tiles).
+     */
+    CompressionConfig compression;
+
+    /** Template support files expanded with vars. Filled in configure(),
+     *  shared between copies.
+     */
+    std::shared_ptr<const ExpandedSupportFile::map> expandedSupportFiles;
+
     LocationConfig()
         : match(Match::prefix)
         , enableBrowser(false), enableListing(false)
         , configClass(FileClass::ephemeral)
+        , bufferLimit(1 << 18)
+        , enableBatch(false), batchLimit(64)
+        , enableReadahead(false)
+        , enableImplicitTiling(false)
+        , tdtContent(TdtContent::b3dm), tdtEmbedTextures(false)
     {}
 
     LocationConfig(const LocationConfig &config, const std::string &location)
@@ -101,6 +175,13 @@ struct LocationConfig {
     bool native() const {
         return enableDataset && (*enableDataset == Format::native);
     }
+
+    /** Returns pre-expanded template support file or null if not available.
+     */
+    const ExpandedSupportFile* expanded(const vs::SupportFile &file) const;
+
+private:
+    void expandSupportFiles();
 };
 
 UTILITY_GENERATE_ENUM_IO(LocationConfig::Match,
@@ -108,4 +189,9 @@ UTILITY_GENERATE_ENUM_IO(LocationConfig::Match,
                          ((regex))
                          )
 
+UTILITY_GENERATE_ENUM_IO(LocationConfig::TdtContent,
+                         ((b3dm))
+                         ((glb))
+                         )
+
 #endif // vtsd_config_hpp_included_
@@ -80,6 +80,8 @@ Daemon::Daemon(const std::string &name, const std::string &version
                              ? boost::thread::hardware_concurrency()
                              : 0)
     , coreThreadCount_(boost::thread::hardware_concurrency())
+    , asyncIo_(true)
+    , asyncIoQueueDepth_(256)
     , defaultConfig_(defaultConfig)
     , proxiesConfigured_(false)
 {
@@ -102,6 +104,13 @@ void Daemon::configurationImpl(po::options_description &cmdline
         ("core.threadCount", po::value(&coreThreadCount_)
          ->default_value(coreThreadCount_)->required()
          , "Number of server core threads.")
+        ("core.asyncIo", po::value(&asyncIo_)
+         ->default_value(asyncIo_)->required()
+         , "Read local files asynchronously (io_uring) when supported "
+         "by the platform. Falls back to blocking reads otherwise.")
+        ("core.asyncIoQueueDepth", po::value(&asyncIoQueueDepth_)
+         ->default_value(asyncIoQueueDepth_)->required()
+         , "Depth of asynchronous I/O queue.")
         ;
 
     if (httpClientThreadCount_) {
@@ -222,6 +231,8 @@ void Daemon::configureImpl(const po::variables_map &vars)
                 }
             })
         << "\n\tcore.threadCount = " << coreThreadCount_
+        << "\n\tcore.asyncIo = " << asyncIo_
+        << "\n\tcore.asyncIoQueueDepth = " << asyncIoQueueDepth_
         << '\n' << utility::dump(openOptions_, "\topen.")
         << utility::LManip([&](std::ostream &os) {
                 for (const auto &location : prefixLocations_) {
@@ -265,6 +276,10 @@ service::Service::Cleanup Daemon::start()
     deliveryCache_.emplace
         (coreThreadCount_, openOptions_, openDriver());
 
+    if (asyncIo_) {
+        asyncReader_.emplace(asyncIoQueueDepth_, coreThreadCount_);
+    }
+
     http_.emplace();
     http_->serverHeader(utility::format
                         ("%s/%s", utility::buildsys::TargetName
@@ -289,7 +304,12 @@ void Daemon::cleanup()
     // FIXME: makes problems when under heavy load
     // TODO: stop accepting new connections, tear down existing ones and destroy
     deliveryCache_ = boost::none;
+    // async reader waits for in-flight reads and their callbacks send data
+    // via HTTP -> stop before HTTP; HTTP threads can still ask for reads
+    // (refused by stopped reader) -> destroy after HTTP
+    if (asyncReader_) { asyncReader_->stop(); }
     http_ = boost::none;
+    asyncReader_ = boost::none;
 }
 
 void Daemon::stat(std::ostream &os)
@@ -323,9 +343,12 @@ void Daemon::handle(const fs::path &filePath
 {
     if (location.enableDataset) {
         return handleDataset(*deliveryCache_, filePath, request
-                             , Sink(sink, location), location);
+                             , Sink(sink, location, asyncReader_.get_ptr())
+                             , location);
     }
-    return handlePlain(filePath, request, Sink(sink, location), location);
+    return handlePlain(filePath, request
+                       , Sink(sink, location, asyncReader_.get_ptr())
+                       , location);
 }
 
 void Daemon::handlePlain(const fs::path &filePath, const http::Request&
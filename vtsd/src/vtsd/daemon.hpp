@@ -39,6 +39,7 @@
 
 #include "config.hpp"
 #include "sink.hpp"
+#include "asyncreader.hpp"
 #include "delivery/cache.hpp"
 
 namespace po = boost::program_options;
@@ -146,6 +147,8 @@ private:
     ThreadCount httpThreadCount_;
     ThreadCount httpClientThreadCount_;
     ThreadCount coreThreadCount_;
+    bool asyncIo_;
+    unsigned int asyncIoQueueDepth_;
 
     vtslibs::vts::OpenOptions openOptions_;
     LocationConfig defaultConfig_;
@@ -157,6 +160,8 @@ private:
 
     boost::optional<DeliveryCache> deliveryCache_;
 
+    boost::optional<AsyncReader> asyncReader_;
+
     bool proxiesConfigured_;
 };
 
@@ -90,9 +90,14 @@ struct Location {
     std::string query;
     boost::optional<std::string> proxy;
 
+    /** Client accepts gzip content encoding.
+     */
+    bool acceptsGzip;
+
     Location(const std::string &path, const std::string &query
-             , const boost::optional<std::string> &proxy = boost::none)
-        : path(path), query(query), proxy(proxy)
+             , const boost::optional<std::string> &proxy = boost::none
+             , bool acceptsGzip = true)
+        : path(path), query(query), proxy(proxy), acceptsGzip(acceptsGzip)
     {}
 };
 
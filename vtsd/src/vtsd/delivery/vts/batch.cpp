@@ -0,0 +1,146 @@
+/**
+ * Copyright (c) 2021 Melown Technologies SE
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * *  Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * *  Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <algorithm>
+
+#include <boost/algorithm/string/split.hpp>
+#include <boost/algorithm/string/classification.hpp>
+
+#include "dbglog/dbglog.hpp"
+
+#include "../../error.hpp"
+
+#include "batch.hpp"
+
+namespace ba = boost::algorithm;
+
+namespace {
+
+template <typename T>
+void write(std::string &out, T value)
+{
+    for (std::size_t i(0); i < sizeof(T); ++i) {
+        out.push_back(char(value & 0xff));
+        value >>= 8;
+    }
+}
+
+} // namespace
+
+const char *TileBatch::contentType = "application/x-vts-batch";
+
+const std::size_t TileBatch::maxCount(0xffff);
+
+TileBatch::TileBatch(std::vector<std::string> names)
+    : names_(std::move(names)), entries_(names_.size())
+    , pending_(names_.size()), lastModified_(-1)
+{}
+
+std::vector<std::string> TileBatch::parse(const std::string &query
+                                          , std::size_t limit)
+{
+    std::vector<std::string> names;
+    ba::split(names, query, ba::is_any_of(","), ba::token_compress_on);
+
+    // drop empty items (e.g. trailing comma)
+    names.erase(std::remove(names.begin(), names.end(), std::string())
+                , names.end());
+
+    if (names.empty()) {
+        LOGTHROW(err1, BadRequest) << "Empty batch.";
+    }
+
+    limit = std::min(limit, maxCount);
+    if (names.size() > limit) {
+        LOGTHROW(err1, BadRequest)
+            << "Too many files in batch (" << names.size()
+            << ", limit is " << limit << ").";
+    }
+
+    for (const auto &name : names) {
+        if (name.size() > 0xffff) {
+            LOGTHROW(err1, BadRequest) << "File name too long.";
+        }
+    }
+
+    return names;
+}
+
+bool TileBatch::set(std::size_t index, TileFilePayload payload)
+{
+    std::lock_guard<std::mutex> guard(mutex_);
+    auto &entry(entries_[index]);
+    entry.payload = std::move(payload);
+    if (entry.payload.data.size() > 0xffffffff) {
+        entry.payload = {};
+        entry.status = Status::error;
+    } else {
+        entry.status = Status::ok;
+        lastModified_ = std::max(lastModified_, entry.payload.lastModified);
+    }
+    return !--pending_;
+}
+
+bool TileBatch::fail(std::size_t index, Status status)
+{
+    std::lock_guard<std::mutex> guard(mutex_);
+    entries_[index].status = status;
+    return !--pending_;
+}
+
+SharedBuffer TileBatch::serialize() const
+{
+    std::size_t size(8);
+    for (std::size_t i(0), e(names_.size()); i != e; ++i) {
+        size += 2 + names_[i].size() + 6 + entries_[i].payload.data.size();
+    }
+
+    auto out(std::make_shared<std::string>());
+    out->reserve(size);
+
+    out->append("VTSB", 4);
+    write<std::uint16_t>(*out, 1);
+    write<std::uint16_t>(*out, names_.size());
+
+    for (std::size_t i(0), e(names_.size()); i != e; ++i) {
+        const auto &name(names_[i]);
+        const auto &entry(entries_[i]);
+
+        write<std::uint16_t>(*out, name.size());
+        out->append(name);
+        write<std::uint8_t>(*out, std::uint8_t(entry.status));
+        write<std::uint8_t>(*out, entry.payload.gzipped ? 0x01 : 0x00);
+
+        if (entry.status == Status::ok) {
+            write<std::uint32_t>(*out, entry.payload.data.size());
+            out->append(entry.payload.data);
+        } else {
+            write<std::uint32_t>(*out, 0);
+        }
+    }
+
+    return out;
+}
@@ -0,0 +1,119 @@
+/**
+ * Copyright (c) 2021 Melown Technologies SE
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * *  Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * *  Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef vtsd_delivery_vts_batch_hpp_included_
+#define vtsd_delivery_vts_batch_hpp_included_
+
+#include <cstdint>
+#include <ctime>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <boost/noncopyable.hpp>
+
+#include "support.hpp"
+
+/** Batch of tile files sent to the client as a single response.
+ *
+ *  Request: GET <dataset>/batch?<file>,<file>,...
+ *  where each <file> is a regular tile file name (e.g. "15-1234-5678.bin",
+ *  "15-1234-5678-0.jpg", "15-1234-5678.nav", "15-1232-5672.meta").
+ *
+ *  Response (content type application/x-vts-batch), all integers are
+ *  little-endian:
+ *
+ *      char[4] magic = "VTSB"
+ *      uint16  version = 1
+ *      uint16  count
+ *      count times:
+ *          uint16  name length
+ *          char[]  name (as requested)
+ *          uint8   status (0 = OK, 1 = not found, 2 = error)
+ *          uint8   flags (bit 0: data are gzip-compressed)
+ *          uint32  data length (0 if status != OK)
+ *          char[]  data
+ *
+ *  Entries are in the same order as in the request.
+ */
+class TileBatch : boost::noncopyable {
+public:
+    typedef std::shared_ptr<TileBatch> pointer;
+
+    enum class Status : std::uint8_t { ok = 0, notFound = 1, error = 2 };
+
+    static const char *contentType;
+
+    /** Maximum number of entries in one batch: count is serialized as uint16.
+     */
+    static const std::size_t maxCount;
+
+    TileBatch(std::vector<std::string> names);
+
+    /** Parses list of files from query. Throws BadRequest on invalid or too
+     *  long list. Limit is clamped to maxCount.
+     */
+    static std::vector<std::string> parse(const std::string &query
+                                          , std::size_t limit);
+
+    const std::vector<std::string>& names() const { return names_; }
+
+    /** Records payload of given entry. Returns true if this was the last
+     *  pending entry.
+     */
+    bool set(std::size_t index, TileFilePayload payload);
+
+    /** Records failure of given entry. Returns true if this was the last
+     *  pending entry.
+     */
+    bool fail(std::size_t index, Status status);
+
+    /** Serializes whole batch. Call only after last entry is set.
+     */
+    SharedBuffer serialize() const;
+
+    /** Newest modification time of all entries.
+     */
+    std::time_t lastModified() const { return lastModified_; }
+
+private:
+    struct Entry {
+        Status status;
+        TileFilePayload payload;
+
+        Entry() : status(Status::error) {}
+    };
+
+    const std::vector<std::string> names_;
+    std::vector<Entry> entries_;
+
+    std::mutex mutex_;
+    std::size_t pending_;
+    std::time_t lastModified_;
+};
+
+#endif // vtsd_delivery_vts_batch_hpp_included_
@@ -40,9 +40,13 @@
 #include "vts-libs/vts/virtualsurface.hpp"
 #include "vts-libs/vts/service.hpp"
 
+#include "../../lrucache.hpp"
+
 #include "driver.hpp"
 #include "mapconfig.hpp"
 #include "support.hpp"
+#include "batch.hpp"
+#include "prefetch.hpp"
 #include "tdt2vts.hpp"
 
 namespace fs = boost::filesystem;
@@ -89,9 +93,14 @@ namespace constants {
     const std::string Dirs("dirs.json");
     const std::string FreeLayerDefinition("freelayer.json");
     const std::string DebugConfig("debug.json");
+    const std::string Batch("batch");
     const std::string Self(".");
     const std::string Index("index.html");
 
+    /** Number of memoized debug nodes per tile index.
+     */
+    const std::size_t DebugNodeCacheSize(1 << 14);
+
     // tileset internals
     namespace tileset {
         const std::string Config("tileset.conf");
@@ -194,12 +203,19 @@ class VtsTileSet : public DriverWrapper
 {
 public:
     VtsTileSet(const std::string &path
-               , const vtslibs::vts::OpenOptions &openOptions)
+               , const vtslibs::vts::OpenOptions &openOptions
+               , DeliveryCache &cache)
         : delivery_(vts::Delivery::open(path, openOptions))
+        , tableCache_(std::make_shared<TileFileTableCache>())
+        , readahead_(std::make_shared<Readahead>
+                     (delivery_, metaBinaryOrder(*delivery_), cache))
     {}
 
-    VtsTileSet(std::shared_ptr<vts::Driver> driver)
+    VtsTileSet(std::shared_ptr<vts::Driver> driver, DeliveryCache &cache)
         : delivery_(vts::Delivery::open(std::move(driver)))
+        , tableCache_(std::make_shared<TileFileTableCache>())
+        , readahead_(std::make_shared<Readahead>
+                     (delivery_, metaBinaryOrder(*delivery_), cache))
     {}
 
     virtual vs::Resources resources() const {
@@ -229,13 +245,59 @@ private:
                     , const ErrorHandler::pointer &errorHandler
                     , const VtsFileInfo &info);
 
+    void handleBatch(Sink &sink, const Location &location
+                     , const LocationConfig &config
+                     , const ErrorHandler::pointer &errorHandler);
+
+    /** Checks tile index whether given tile file exists.
+     */
+    bool exists(const VtsFileInfo &info) const;
+
     vts::Delivery::pointer delivery_;
     mc::LazyConfigHolder<mc::MapConfig> mapConfig_;
     mc::LazyConfigHolder<mc::Definition> definition_;
+
+    /** Cache of parsed sub-file tables.
+     */
+    TileFileTableCache::pointer tableCache_;
+
+    /** Metatile-driven readahead.
+     */
+    Readahead::pointer readahead_;
+
+    static unsigned int metaBinaryOrder(const vts::Delivery &delivery) {
+        return vr::system.referenceFrames
+            (delivery.properties().referenceFrame).metaBinaryOrder;
+    }
 };
 
+bool VtsTileSet::exists(const VtsFileInfo &info) const
+{
+    const auto &index(delivery_->index());
+    const auto flags([&]() { return index.tileIndex.get(info.tileId); });
+
+    switch (info.tileFile) {
+    case vs::TileFile::meta:
+        return index.meta(info.tileId);
+
+    case vs::TileFile::mesh:
+        return flags() & vts::TileIndex::Flag::mesh;
+
+    case vs::TileFile::atlas:
+        return flags() & vts::TileIndex::Flag::atlas;
+
+    case vs::TileFile::navtile:
+        return flags() & vts::TileIndex::Flag::navtile;
+
+    default: break;
+    }
+
+    // let the driver decide
+    return true;
+}
+
 void VtsTileSet::handleTile(Sink &sink, const Location &location
-                            , const LocationConfig&
+                            , const LocationConfig &config
                             , const ErrorHandler::pointer &errorHandler
                             , const VtsFileInfo &info)
 {
@@ -246,7 +308,29 @@ void VtsTileSet::handleTile(Sink &sink, const Location &location
         return;
     }
 
+    switch (info.flavor) {
+    case vts::FileFlavor::regular:
+    case vts::FileFlavor::raw:
+        if (!exists(info)) {
+            // no such tile, no I/O needed; let the client (and any CDN)
+            // cache this answer
+            return sink.error(utility::makeError<NotFound>
+                              ("No such tile file.")
+                              , FileClass::negative);
+        }
+        break;
+
+    default: break;
+    }
+
+    // client is going to ask for content of served metatile soon
+    const auto readahead
+        ((config.enableReadahead && (info.tileFile == vs::TileFile::meta)
+          && (info.flavor == vts::FileFlavor::regular))
+         ? readahead_ : Readahead::pointer());
+
     // run asynchronously
+    const auto tableCache(tableCache_);
     delivery_->input(info.tileId, info.tileFile, info.flavor
                      , [=](const vts::EIStream &eis) mutable -> void
     {
@@ -258,7 +342,10 @@ void VtsTileSet::handleTile(Sink &sink, const Location &location
 
                 tileFileStream(sink, location, info
                                , info.subTileFile, info.tileId
-                               , std::move(is));
+                               , std::move(is), tableCache.get());
+
+                // response is on its way, schedule readahead
+                if (readahead) { (*readahead)(info.tileId); }
             } catch (...) {
                 (*errorHandler)();
             }
@@ -266,10 +353,74 @@ void VtsTileSet::handleTile(Sink &sink, const Location &location
     });
 }
 
+void VtsTileSet::handleBatch(Sink &sink, const Location &location
+                             , const LocationConfig &config
+                             , const ErrorHandler::pointer &errorHandler)
+{
+    auto batch(std::make_shared<TileBatch>
+               (TileBatch::parse(location.query, config.batchLimit)));
+
+    const auto send([batch, errorHandler](Sink &sink)
+    {
+        try {
+            sink.content(batch->serialize()
+                         , Sink::FileInfo(TileBatch::contentType
+                                          , batch->lastModified())
+                         .setFileClass(FileClass::data));
+        } catch (...) {
+            (*errorHandler)();
+        }
+    });
+
+    const auto tableCache(tableCache_);
+    const auto &names(batch->names());
+    for (std::size_t index(0), e(names.size()); index != e; ++index) {
+        const VtsFileInfo info(names[index], config);
+        if ((info.type != FileInfo::Type::tileFile)
+            || (info.flavor != vts::FileFlavor::regular)
+            || !exists(info))
+        {
+            if (batch->fail(index, TileBatch::Status::notFound)) {
+                send(sink);
+            }
+            continue;
+        }
+
+        // run asynchronously
+        delivery_->input(info.tileId, info.tileFile, info.flavor
+                         , [=](const vts::EIStream &eis) mutable -> void
+        {
+            bool last(false);
+            try {
+                last = batch->set
+                    (index, tileFilePayload(info, info.subTileFile
+                                            , info.tileId, eis.get()
+                                            , tableCache.get()));
+            } catch (const vs::NoSuchFile&) {
+                last = batch->fail(index, TileBatch::Status::notFound);
+            } catch (const std::exception &e) {
+                LOG(err1) << "Failed to read batched file <"
+                          << info.path << ">: <" << e.what() << ">.";
+                last = batch->fail(index, TileBatch::Status::error);
+            }
+
+            if (last) { send(sink); }
+        });
+    }
+}
+
 void VtsTileSet::handle(Sink sink, const Location &location
                         , const LocationConfig &config
                         , const ErrorHandler::pointer &errorHandler)
 {
+    if (config.enableBatch && (location.path == constants::Batch)) {
+        try {
+            return handleBatch(sink, location, config, errorHandler);
+        } catch (...) {
+            return (*errorHandler)();
+        }
+    }
+
     // we want internals
     const VtsFileInfo info
         (location.path, config, ExtraFlags::enableTilesetInternals);
@@ -331,15 +482,12 @@ void VtsTileSet::handle(Sink sink, const Location &location
             // unknown file, let's test other members
             if (info.registry) {
                 // it's registry file!
-                return sink.content(vs::fileIStream(info.registry->contentType
-                                                    , info.registry->path)
-                                    , FileClass::registry);
+                return sendRegistryFile(sink, *info.registry);
             }
 
             if (info.service) {
-                return sink.content(vts::service::generate
-                                    (info.service, info.path, location.query)
-                                    , FileClass::data);
+                return sendService(sink, info.service, info.path
+                                   , location.query);
             }
             break;
 
@@ -442,9 +590,7 @@ void VtsStorage::handle(Sink sink, const Location &location
     // unknonw file, let's test other members
     if (info.registry) {
         // it's registry file!
-        return sink.content(vs::fileIStream(info.registry->contentType
-                                            , info.registry->path)
-                            , FileClass::registry);
+        return sendRegistryFile(sink, *info.registry);
     }
 
     if (info.support) {
@@ -458,9 +604,7 @@ void VtsStorage::handle(Sink sink, const Location &location
     }
 
     if (info.service) {
-        return sink.content(vts::service::generate
-                            (info.service, info.path, location.query)
-                            , FileClass::data);
+        return sendService(sink, info.service, info.path, location.query);
     }
 
     // wtf?
@@ -521,9 +665,7 @@ void VtsStorageView::handle(Sink sink, const Location &location
     // unknonw file, let's test other members
     if (info.registry) {
         // it's registry file!
-        return sink.content(vs::fileIStream(info.registry->contentType
-                                            , info.registry->path)
-                            , FileClass::registry);
+        return sendRegistryFile(sink, *info.registry);
     }
 
     if (info.support) {
@@ -532,9 +674,7 @@ void VtsStorageView::handle(Sink sink, const Location &location
     }
 
     if (info.service) {
-        return sink.content(vts::service::generate
-                            (info.service, info.path, location.query)
-                            , FileClass::data);
+        return sendService(sink, info.service, info.path, location.query);
     }
 
     // wtf?
@@ -546,6 +686,7 @@ class VtsTileIndex : public DriverWrapper
 public:
     VtsTileIndex(const fs::path &path)
         : path_(path), stat_(vs::FileStat::stat(path))
+        , debugNodes_(constants::DebugNodeCacheSize)
     {
         // load tile index
         ti_.load(path);
@@ -567,7 +708,7 @@ public:
 
         std::ostringstream os;
         vts::saveDebug(os, dc);
-        debugData_ = os.str();
+        debugData_ = std::make_shared<const std::string>(os.str());
 
         debugStat_ = stat_;
         debugStat_.contentType = vs::contentType(vs::File::config);
@@ -590,14 +731,32 @@ public:
     virtual bool hotContent() const { return false; }
 
 private:
+    /** Returns serialized debug node for given tile (memoized).
+     */
+    SharedBuffer debugNode(const vts::TileId &tileId);
+
     const fs::path path_;
     vts::TileIndex ti_;
     vs::FileStat stat_;
-    std::string debugData_;
+    SharedBuffer debugData_;
     vs::FileStat debugStat_;
     vs::FileStat maskStat_;
+
+    /** Serialized debug nodes, most recently used.
+     */
+    LruCache<vts::TileId, SharedBuffer> debugNodes_;
 };
 
+SharedBuffer VtsTileIndex::debugNode(const vts::TileId &tileId)
+{
+    return debugNodes_.get(tileId, [&]() -> SharedBuffer
+    {
+        std::ostringstream os;
+        vts::saveDebug(os, vts::getNodeDebugInfo(ti_, tileId));
+        return std::make_shared<const std::string>(os.str());
+    });
+}
+
 const auto emptyDebugMask([]() -> std::vector<char>
 {
     return imgproc::png::serialize(vts::emptyDebugMask(), 9);
@@ -636,13 +795,10 @@ void VtsTileIndex::handle(Sink sink, const Location &location
     case FileInfo::Type::tileFile:
         if (info.flavor == vts::FileFlavor::debug) {
             switch (info.tileFile) {
-            case vs::TileFile::meta: {
-                std::ostringstream os;
-                vts::saveDebug
-                    (os, vts::getNodeDebugInfo(ti_, info.tileId));
+            case vs::TileFile::meta:
                 return sink.content
-                    (os.str(), fileinfo(debugStat_, FileClass::data));
-            }
+                    (debugNode(info.tileId)
+                     , fileinfo(debugStat_, FileClass::data));
 
             case vs::TileFile::mask:
                 return sink.content
@@ -662,9 +818,7 @@ void VtsTileIndex::handle(Sink sink, const Location &location
     // unknonw file, let's test other members
     if (info.registry) {
         // it's registry file!
-        return sink.content(vs::fileIStream(info.registry->contentType
-                                            , info.registry->path)
-                            , FileClass::registry);
+        return sendRegistryFile(sink, *info.registry);
     }
 
     if (info.support) {
@@ -755,7 +909,7 @@ openTileSet(const std::string &path
 
         virtual void done(std::shared_ptr<vts::Driver> driver) {
             callback(DriverWrapper::pointer
-                     (std::make_shared<VtsTileSet>(std::move(driver))));
+                     (std::make_shared<VtsTileSet>(std::move(driver), cache)));
         }
 
         virtual void openStorage(const boost::filesystem::path &path
@@ -836,15 +990,20 @@ DriverWrapper::pointer open3dTiles(const std::string &path
                                    , const OpenOptions &openOptions
                                    , DeliveryCache &cache
                                    , const DeliveryCache::Callback &callback
-                                   , bool)
+                                   , bool
+                                   , const vts2tdt::MeshCacheOptions
+                                   &meshCache
+                                   , const vts2tdt::RegionCacheOptions
+                                   &regionCache)
 {
     cache.get(path, Format::native
-              , [=](const DeliveryCache::Expected &value)
+              , [=, &cache](const DeliveryCache::Expected &value)
     {
         try {
             callback(DriverWrapper::pointer
                      (std::make_shared<Tdt2VtsTileSet>
-                      (VtsTileSet::asDelivery(value.get()))));
+                      (VtsTileSet::asDelivery(value.get()), path
+                       , meshCache, regionCache, cache)));
         } catch (...) {
             callback(std::current_exception());
         }
@@ -860,14 +1019,18 @@ DriverWrapper::pointer openVts(const std::string &path
                                , const OpenOptions &openOptions
                                , DeliveryCache &cache
                                , const DeliveryCache::Callback &callback
-                               , bool proxiesAllowed)
+                               , bool proxiesAllowed
+                               , const vts2tdt::MeshCacheOptions &meshCache
+                               , const vts2tdt::RegionCacheOptions
+                               &regionCache)
 {
     switch (openOptions.format) {
     case Format::native:
         return openVtsImpl(path, openOptions, cache, callback, proxiesAllowed);
 
     case Format::threedtiles:
-        return open3dTiles(path, openOptions, cache, callback, proxiesAllowed);
+        return open3dTiles(path, openOptions, cache, callback, proxiesAllowed
+                           , meshCache, regionCache);
     }
 
     return {}; // never reached
@@ -32,11 +32,18 @@
 
 // inject support files
 #include "tdt2vts/support.hpp"
+#include "tdt2vts/meshcache.hpp"
+#include "tdt2vts/metabuilder.hpp"
 
 DriverWrapper::pointer openVts(const std::string &path
                                , const OpenOptions &openOptions
                                , DeliveryCache &cache
                                , const DeliveryCache::Callback &callback
-                               , bool proxiesConfigured);
+                               , bool proxiesConfigured
+                               , const vts2tdt::MeshCacheOptions &meshCache
+                               = vts2tdt::MeshCacheOptions()
+                               , const vts2tdt::RegionCacheOptions
+                               &regionCache
+                               = vts2tdt::RegionCacheOptions());
 
 #endif // libvtslibs_http_vts_driver_hpp_included_
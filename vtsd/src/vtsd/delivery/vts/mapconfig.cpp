@@ -78,31 +78,52 @@ void SimpleMapConfig::sendDirs(Sink &sink, const vts::OProxy&
     dirs.send(sink, fileClass);
 }
 
-void ProxiedMapConfig::sendMapConfig(Sink &sink, const vts::OProxy &proxy
-                                     , FileClass fileClass)
-    const
+template <typename Serialize>
+const SerializedConfig&
+ProxiedMapConfig::get(Cache &cache, const vts::OProxy &proxy
+                      , Serialize serialize) const
 {
+    {
+        std::lock_guard<std::mutex> guard(cacheMutex_);
+        auto fcache(cache.find(proxy));
+        if (fcache != cache.end()) { return fcache->second; }
+    }
+
+    // serialize outside lock
     vts::MapConfigOptions mco;
     mco.proxy = proxy;
     std::ostringstream os;
-    saveMapConfig(mc_, os, &mco);
+    serialize(os, mco);
+
+    // NB: std::map never invalidates references to existing elements; another
+    // thread may have been faster, use its output then
+    std::lock_guard<std::mutex> guard(cacheMutex_);
+    return cache.insert
+        (Cache::value_type
+         (proxy, SerializedConfig(os.str(), lastModified_
+                                  , vts::MapConfig::contentType)))
+        .first->second;
+}
 
-    return SerializedConfig
-        (os.str(), lastModified_, vts::MapConfig::contentType)
-        .send(sink, fileClass);
+void ProxiedMapConfig::sendMapConfig(Sink &sink, const vts::OProxy &proxy
+                                     , FileClass fileClass)
+    const
+{
+    get(mapConfigCache_, proxy
+        , [this](std::ostream &os, const vts::MapConfigOptions &mco)
+    {
+        saveMapConfig(mc_, os, &mco);
+    }).send(sink, fileClass);
 }
 
 void ProxiedMapConfig::sendDirs(Sink &sink, const vts::OProxy &proxy
                                 , FileClass fileClass) const
 {
-    vts::MapConfigOptions mco;
-    mco.proxy = proxy;
-    std::ostringstream os;
-    saveDirs(mc_, os, &mco);
-
-    return SerializedConfig
-        (os.str(), lastModified_, vts::MapConfig::contentType)
-        .send(sink, fileClass);
+    get(dirsCache_, proxy
+        , [this](std::ostream &os, const vts::MapConfigOptions &mco)
+    {
+        saveDirs(mc_, os, &mco);
+    }).send(sink, fileClass);
 }
 
 void Definition::init(const vts::MeshTilesConfig &mtc
@@ -27,10 +27,12 @@
 #ifndef vtsd_vts_mapconfig_hpp_included_
 #define vtsd_vts_mapconfig_hpp_included_
 
+#include <atomic>
+#include <map>
+#include <memory>
 #include <mutex>
 
 #include <boost/optional.hpp>
-#include <boost/utility/in_place_factory.hpp>
 
 #include "vts-libs/vts/mapconfig.hpp"
 #include "vts-libs/storage/streams.hpp"
@@ -45,40 +47,52 @@ namespace vr = vtslibs::registry;
 
 vts::MapConfig augmentMapConfig(vts::MapConfig &&mc);
 
+/** Lazily constructed value. Once constructed, access is lock-free; mutex is
+ *  used only while value is being constructed.
+ */
 template <typename T>
 class LazyConfigHolder {
 public:
-    LazyConfigHolder() = default;
+    LazyConfigHolder() : ready_(nullptr) {}
 
     template <typename ...Args> T& operator()(Args &&...args) const {
+        // fast path
+        if (auto *data = ready_.load(std::memory_order_acquire)) {
+            return *data;
+        }
+
         std::lock_guard<std::mutex> guard(mutex_);
-        if (!data_) { data_ = boost::in_place(std::forward<Args>(args)...); }
+        if (!data_) {
+            data_.reset(new T(std::forward<Args>(args)...));
+            ready_.store(data_.get(), std::memory_order_release);
+        }
         return *data_;
     }
 
 private:
     mutable std::mutex mutex_;
-    mutable boost::optional<T> data_;
+    mutable std::unique_ptr<T> data_;
+    mutable std::atomic<T*> ready_;
 };
 
 struct SerializedConfig {
-    std::string data;
+    SharedBuffer data;
     vs::FileStat stat;
 
     SerializedConfig() = default;
 
     SerializedConfig(std::string inData, std::time_t lastModified
                      , const char *contentType)
-        : data(std::move(inData))
-        , stat(data.size(), lastModified, contentType)
+        : data(std::make_shared<const std::string>(std::move(inData)))
+        , stat(data->size(), lastModified, contentType)
     {}
 
     void set(std::string data, std::time_t lastModified
              , const char *contentType)
     {
-        this->data = std::move(data);
+        this->data = std::make_shared<const std::string>(std::move(data));
         this->stat = vs::FileStat
-            (this->data.size(), lastModified, contentType);
+            (this->data->size(), lastModified, contentType);
     }
 
     void send(Sink &sink, FileClass fileClass) const {
@@ -118,18 +132,26 @@ public:
     class Lazy;
 };
 
+/** Lazily constructed map config. Lock-free once constructed.
+ */
 class PotentiallyProxiedMapConfig::Lazy {
 public:
-    Lazy() = default;
+    Lazy() : ready_(nullptr) {}
 
     template <typename Source>
     const PotentiallyProxiedMapConfig&
     operator()(const Source &source, bool proxiesAllowed) const
     {
+        // fast path
+        if (const auto *data = ready_.load(std::memory_order_acquire)) {
+            return *data;
+        }
+
         std::lock_guard<std::mutex> guard(mutex_);
         if (!data_) {
             data_ = PotentiallyProxiedMapConfig::factory
                 (source, proxiesAllowed);
+            ready_.store(data_.get(), std::memory_order_release);
         }
         return *data_;
     }
@@ -137,6 +159,7 @@ public:
 private:
     mutable std::mutex mutex_;
     mutable PotentiallyProxiedMapConfig::pointer data_;
+    mutable std::atomic<const PotentiallyProxiedMapConfig*> ready_;
 };
 
 class SimpleMapConfig
@@ -170,8 +193,24 @@ public:
                           , FileClass fileClass) const;
 
 private:
+    typedef std::map<vts::OProxy, SerializedConfig> Cache;
+
+    /** Returns serialized output for given proxy from cache, serializing it
+     *  on first use.
+     */
+    template <typename Serialize>
+    const SerializedConfig& get(Cache &cache, const vts::OProxy &proxy
+                                , Serialize serialize) const;
+
     vts::MapConfig mc_;
     std::time_t lastModified_;
+
+    /** Serialized output per proxy. Proxies are limited to location's
+     *  allowed proxies, i.e. this is bounded.
+     */
+    mutable std::mutex cacheMutex_;
+    mutable Cache mapConfigCache_;
+    mutable Cache dirsCache_;
 };
 
 struct Definition {
@@ -27,6 +27,8 @@
 #ifndef vtsd_delivery_vts_po_hpp_included_
 #define vtsd_delivery_vts_po_hpp_included_
 
+#include <vector>
+
 #include <boost/program_options.hpp>
 
 #include "vts-libs/storage/support.hpp"
@@ -35,4 +37,10 @@ void varsConfiguration(boost::program_options::options_description &od
                        , const std::string &prefix
                        , vtslibs::storage::SupportFile::Vars &vars);
 
+/** All compiled-in support file sets whose templates are expanded with
+ *  variables configured by varsConfiguration.
+ */
+std::vector<const vtslibs::storage::SupportFile::Files*>
+templateSupportFiles();
+
 #endif // vtsd_delivery_vts_po_hpp_included_
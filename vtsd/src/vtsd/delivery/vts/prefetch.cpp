@@ -0,0 +1,224 @@
+/**
+ * Copyright (c) 2021 Melown Technologies SE
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * *  Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * *  Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <algorithm>
+#include <tuple>
+
+#include <fcntl.h>
+
+#include "dbglog/dbglog.hpp"
+
+#include "prefetch.hpp"
+
+namespace vts = vtslibs::vts;
+namespace vs = vtslibs::storage;
+
+namespace {
+
+namespace constants {
+    /** Maximum number of nodes read ahead per metatile.
+     */
+    const std::size_t MaxNodes(256);
+
+    /** Number of recently read ahead metatiles remembered.
+     */
+    const std::size_t RecentMetatiles(1024);
+
+    /** Maximum number of pending readaheads per tileset.
+     */
+    const std::size_t MaxPending(4);
+
+    /** Windows of the same file at most this far apart are merged.
+     */
+    const std::size_t MaxGap(1 << 16);
+}
+
+/** Collects windows of streams opened for readahead. When the last opener
+ *  releases it (i.e. all streams have been opened), windows are coalesced and
+ *  announced to the kernel and the streams are closed.
+ */
+class Collector : boost::noncopyable {
+public:
+    typedef std::shared_ptr<Collector> pointer;
+
+    ~Collector();
+
+    void add(const vs::IStream::pointer &is);
+
+private:
+    std::mutex mutex_;
+    FileWindows windows_;
+
+    /** Streams are kept open (i.e. their file descriptors valid) until
+     *  advised.
+     */
+    std::vector<vs::IStream::pointer> streams_;
+};
+
+void Collector::add(const vs::IStream::pointer &is)
+{
+    if (const auto rofd = is->fd()) {
+        std::lock_guard<std::mutex> guard(mutex_);
+        windows_.emplace_back(rofd->fd, rofd->start, rofd->end);
+        streams_.push_back(is);
+        return;
+    }
+
+    // not a local file
+    is->close();
+}
+
+Collector::~Collector()
+{
+    const auto windows(coalesce(std::move(windows_), constants::MaxGap));
+    for (const auto &w : windows) {
+        ::posix_fadvise(w.fd, w.start, w.end - w.start, POSIX_FADV_WILLNEED);
+    }
+
+    for (const auto &is : streams_) {
+        try { is->close(); } catch (...) {}
+    }
+
+    LOG(debug) << "Readahead: " << streams_.size() << " files, "
+               << windows.size() << " ranges.";
+}
+
+} // namespace
+
+FileWindows coalesce(FileWindows windows, std::size_t maxGap)
+{
+    std::sort(windows.begin(), windows.end()
+              , [](const FileWindow &l, const FileWindow &r)
+    {
+        return (std::tie(l.fd, l.start, l.end)
+                < std::tie(r.fd, r.start, r.end));
+    });
+
+    FileWindows out;
+    for (const auto &w : windows) {
+        if (!out.empty() && (out.back().fd == w.fd)
+            && (w.start <= out.back().end + maxGap))
+        {
+            out.back().end = std::max(out.back().end, w.end);
+            continue;
+        }
+        out.push_back(w);
+    }
+    return out;
+}
+
+Readahead::Readahead(const vts::Delivery::pointer &delivery
+                     , unsigned int metaBinaryOrder, DeliveryCache &cache)
+    : delivery_(delivery), metaBinaryOrder_(metaBinaryOrder), cache_(cache)
+    , recent_(constants::RecentMetatiles), pending_(0)
+{}
+
+bool Readahead::fresh(const vts::TileId &metaId)
+{
+    std::lock_guard<std::mutex> guard(mutex_);
+    if (recent_.get(metaId)) { return false; }
+    recent_.put(metaId, true);
+    return true;
+}
+
+void Readahead::run(const vts::MetaTile &meta)
+{
+    const auto origin(meta.origin());
+    const auto collector(std::make_shared<Collector>());
+
+    std::size_t nodes(0);
+    const auto size(1u << metaBinaryOrder_);
+    for (unsigned int j(0); (j < size) && (nodes < constants::MaxNodes); ++j) {
+        for (unsigned int i(0); (i < size) && (nodes < constants::MaxNodes);
+             ++i)
+        {
+            const vts::TileId tileId(origin.lod, origin.x + i, origin.y + j);
+            const auto *node(meta.get(tileId, std::nothrow));
+            if (!node || !node->real()) { continue; }
+            ++nodes;
+
+            auto open([&](vs::TileFile type)
+            {
+                delivery_->input(tileId, type, vts::FileFlavor::raw
+                                 , [collector](const vts::EIStream &eis)
+                {
+                    try {
+                        collector->add(eis.get());
+                    } catch (...) {}
+                });
+            });
+
+            open(vs::TileFile::mesh);
+            if (node->internalTextureCount()) { open(vs::TileFile::atlas); }
+        }
+    }
+
+    // NB: collector advises when last pending open releases it
+}
+
+void Readahead::run(const vts::TileId &metaId)
+{
+    const auto self(shared_from_this());
+    try {
+        delivery_->input(metaId, vs::TileFile::meta, vts::FileFlavor::regular
+                         , [self](const vts::EIStream &eis)
+        {
+            try {
+                const auto is(eis.get());
+                const auto meta(vts::loadMetaTile
+                                (*is, self->metaBinaryOrder_, is->name()));
+                is->close();
+                self->run(meta);
+            } catch (const std::exception &e) {
+                LOG(info1) << "Readahead of metatile failed: <"
+                           << e.what() << ">.";
+            } catch (...) {}
+        });
+    } catch (const std::exception &e) {
+        LOG(info1) << "Readahead of metatile " << metaId << " failed: <"
+                   << e.what() << ">.";
+    } catch (...) {}
+}
+
+void Readahead::operator()(const vts::TileId &metaId)
+{
+    // drop if too busy or read ahead recently
+    if ((pending_.fetch_add(1) >= constants::MaxPending) || !fresh(metaId)) {
+        --pending_;
+        return;
+    }
+
+    try {
+        const auto self(shared_from_this());
+        cache_.post([](const DeliveryCache::Expected&) {}, [self, metaId]()
+        {
+            self->run(metaId);
+            --self->pending_;
+        });
+    } catch (...) {
+        --pending_;
+    }
+}
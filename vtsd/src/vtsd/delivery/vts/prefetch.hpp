@@ -0,0 +1,129 @@
+/**
+ * Copyright (c) 2021 Melown Technologies SE
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * *  Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * *  Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef vtsd_delivery_vts_prefetch_hpp_included_
+#define vtsd_delivery_vts_prefetch_hpp_included_
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include <boost/noncopyable.hpp>
+
+#include "vts-libs/vts/metatile.hpp"
+#include "vts-libs/vts/tileset/delivery.hpp"
+
+#include "../../lrucache.hpp"
+#include "../cache.hpp"
+
+/** Window of local file to be read ahead.
+ */
+struct FileWindow {
+    int fd;
+    std::size_t start;
+    std::size_t end;
+
+    FileWindow(int fd, std::size_t start, std::size_t end)
+        : fd(fd), start(start), end(end)
+    {}
+};
+
+typedef std::vector<FileWindow> FileWindows;
+
+/** Merges windows of the same file that overlap or are at most maxGap bytes
+ *  apart. Result is sorted by file and offset.
+ */
+FileWindows coalesce(FileWindows windows, std::size_t maxGap);
+
+/** Metatile-driven readahead.
+ *
+ *  For every real node listed in a served metatile (at most 256 nodes)
+ *  opens its mesh and atlas (if any) and collects windows of local files
+ *  backing them. Windows are then coalesced, i.e. tiles stored next to each
+ *  other in one tilar file are announced to the kernel as a single range via
+ *  one posix_fadvise(POSIX_FADV_WILLNEED) call. Remote (non-fd) streams are
+ *  ignored.
+ *
+ *  Readahead runs in delivery cache worker and must be scheduled only after
+ *  metatile response has been handed to the sink: it re-reads the metatile
+ *  and, for local drivers, opens all files synchronously.
+ *
+ *  Metatiles read ahead recently (bounded LRU) are skipped and at most a few
+ *  readaheads per tileset are pending at any time (others are dropped), i.e.
+ *  readahead never floods cache workers. All errors are logged and ignored.
+ */
+class Readahead
+    : boost::noncopyable
+    , public std::enable_shared_from_this<Readahead>
+{
+public:
+    typedef std::shared_ptr<Readahead> pointer;
+
+    /** Creates readahead for given tileset.
+     *
+     * \param delivery tileset delivery interface
+     * \param metaBinaryOrder reference frame's meta binary order
+     * \param cache delivery cache whose workers run the readahead
+     */
+    Readahead(const vtslibs::vts::Delivery::pointer &delivery
+              , unsigned int metaBinaryOrder, DeliveryCache &cache);
+
+    /** Schedules readahead of content of given metatile unless it has been
+     *  read ahead recently. Returns immediately. Never throws.
+     */
+    void operator()(const vtslibs::vts::TileId &metaId);
+
+private:
+    /** Loads metatile and reads ahead its content. Runs in cache worker.
+     */
+    void run(const vtslibs::vts::TileId &metaId);
+
+    /** Reads ahead content of loaded metatile.
+     */
+    void run(const vtslibs::vts::MetaTile &meta);
+
+    /** Returns true if metatile has not been read ahead recently and marks it
+     *  as read ahead.
+     */
+    bool fresh(const vtslibs::vts::TileId &metaId);
+
+    vtslibs::vts::Delivery::pointer delivery_;
+    unsigned int metaBinaryOrder_;
+    DeliveryCache &cache_;
+
+    std::mutex mutex_;
+
+    /** Metatiles read ahead recently.
+     */
+    LruCache<vtslibs::vts::TileId, bool> recent_;
+
+    /** Number of scheduled but not yet finished readaheads.
+     */
+    std::atomic<std::size_t> pending_;
+};
+
+#endif // vtsd_delivery_vts_prefetch_hpp_included_
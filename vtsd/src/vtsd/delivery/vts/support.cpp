@@ -24,12 +24,26 @@
  * POSSIBILITY OF SUCH DAMAGE.
  */
 
+#include <ctime>
+#include <map>
+#include <mutex>
+#include <sstream>
+#include <tuple>
+
 #include <boost/program_options.hpp>
 
 #include "dbglog/dbglog.hpp"
 
+#include "vts-libs/vts/support.hpp"
+#include "vts-libs/vts/service.hpp"
+#include "vts-libs/vts0/support.hpp"
+#include "vts-libs/storage/fstreams.hpp"
+
+#include "../../compress.hpp"
+
 #include "po.hpp"
 #include "tdt2vts/po.hpp"
+#include "tdt2vts/support.hpp"
 #include "support.hpp"
 
 namespace po = boost::program_options;
@@ -37,27 +51,189 @@ namespace vts = vtslibs::vts;
 namespace vs = vtslibs::storage;
 namespace vr = vtslibs::registry;
 
+namespace {
+
+TileFileTable readTable(const FileInfo &info, vs::IStream &is)
+{
+    TileFileTable t;
+    switch (info.tileFile) {
+    case vs::TileFile::mesh:
+        t.table = vts::readMeshTable(is, is.name());
+        break;
+
+    case vs::TileFile::atlas:
+        t.table = vts::Atlas::readTable(is, is.name());
+        break;
+
+    case vs::TileFile::navtile:
+        t.table = vts::NavTile::readTable(is, is.name());
+        break;
+
+    default: break;
+    }
+    return t;
+}
+
+/** Memoized service output.
+ */
+struct GeneratedFile {
+    SharedBuffer data;
+    std::string contentType;
+    std::time_t lastModified;
+    std::string etag;
+};
+
+typedef std::tuple<unsigned int, std::string, std::string> ServiceKey;
+
+/** Number of memoized service responses.
+ */
+const std::size_t ServiceCacheSize(1024);
+
+LruCache<ServiceKey, GeneratedFile> serviceCache(ServiceCacheSize);
+
+/** Registry data files loaded so far. Registry is static, i.e. this is
+ *  bounded.
+ */
+struct RegistryFiles {
+    std::mutex mutex;
+    std::map<std::string, GeneratedFile> files;
+};
+
+RegistryFiles registryFiles;
+
+/** Reads size bytes at given offset into data. Data are truncated on short
+ *  read.
+ */
+void readRange(vs::IStream &is, std::size_t start, std::size_t size
+               , std::string &data)
+{
+    data.resize(size);
+    std::size_t done(0);
+    while (done < size) {
+        const auto r(is.read(&data[done], size - done, start + done));
+        if (!r) { break; }
+        done += r;
+    }
+    data.resize(done);
+}
+
+} // namespace
+
+TileFileTable tileFileTable(const FileInfo &info
+                            , const vts::TileId &tileId
+                            , const vs::IStream::pointer &is
+                            , TileFileTableCache *tableCache)
+{
+    const TileFileTableKey key(tileId, info.tileFile);
+    if (tableCache) {
+        if (auto cached = tableCache->get(key)) { return *cached; }
+    }
+
+    auto t(readTable(info, *is));
+    if (info.tileFile == vs::TileFile::mesh) {
+        t.gzipped = vs::gzipped(is, t.table[vts::Mesh::meshIndex()].start);
+    }
+
+    if (tableCache) { tableCache->put(key, t); }
+    return t;
+}
+
+TileFilePayload tileFilePayload(const FileInfo &info
+                                , unsigned int subTileFile
+                                , const vts::TileId &tileId
+                                , const vs::IStream::pointer &is
+                                , TileFileTableCache *tableCache)
+{
+    TileFilePayload payload;
+    const auto stat(is->stat());
+    payload.lastModified = stat.lastModified;
+
+    // whole file by default
+    std::size_t start(0), size(stat.size);
+
+    switch (info.tileFile) {
+    case vs::TileFile::mesh:
+    case vs::TileFile::atlas:
+    case vs::TileFile::navtile: {
+        const auto tft(tileFileTable(info, tileId, is, tableCache));
+        const auto &table(tft.table);
+
+        std::size_t index(0);
+        switch (info.tileFile) {
+        case vs::TileFile::mesh: index = vts::Mesh::meshIndex(); break;
+        case vs::TileFile::navtile: index = vts::NavTile::imageIndex(); break;
+        default: index = subTileFile; break;
+        }
+
+        if (index >= table.size()) {
+            LOGTHROW(err1, vs::NoSuchFile)
+                << "Sub-file index " << index
+                << " out of range in file: \"" << info.path << "\".";
+        }
+
+        start = table[index].start;
+        size = table[index].size;
+        payload.gzipped = tft.gzipped;
+        break;
+    }
+
+    default: break;
+    }
+
+    is->get().exceptions(std::ios::badbit);
+    readRange(*is, start, size, payload.data);
+    is->close();
+
+    return payload;
+}
+
+std::vector<std::string> tileSubFiles(const FileInfo &info
+                                      , const vts::TileId &tileId
+                                      , const vs::IStream::pointer &is
+                                      , TileFileTableCache *tableCache)
+{
+    const auto tft(tileFileTable(info, tileId, is, tableCache));
+
+    is->get().exceptions(std::ios::badbit);
+    std::vector<std::string> files(tft.table.size());
+    for (std::size_t i(0), e(files.size()); i != e; ++i) {
+        readRange(*is, tft.table[i].start, tft.table[i].size, files[i]);
+    }
+    is->close();
+
+    return files;
+}
+
 void tileFileStream(Sink &sink, const Location &location
                     , const FileInfo &info
                     , unsigned int subTileFile
                     , const vts::TileId &tileId
-                    , vs::IStream::pointer &&is)
+                    , vs::IStream::pointer &&is
+                    , TileFileTableCache *tableCache)
 {
     switch (info.tileFile) {
-    case vs::TileFile::mesh: {
-        // read sub-file table from stream
-        auto entry(vts::readMeshTable(*is, is->name())
-                   [vts::Mesh::meshIndex()]);
+    case vs::TileFile::mesh:
+    case vs::TileFile::atlas:
+    case vs::TileFile::navtile:
+        break;
+
+    default:
+        // default handler
+        return sink.content(std::move(is), FileClass::data);
+    }
+
+    // get sub-file table, either from cache or from stream
+    const auto tft(tileFileTable(info, tileId, is, tableCache));
+    const auto &table(tft.table);
 
+    switch (info.tileFile) {
+    case vs::TileFile::mesh: {
+        const auto &entry(table[vts::Mesh::meshIndex()]);
         return sink.content(std::move(is), FileClass::data
-                            , entry.start, entry.size
-                            , vs::gzipped(is, entry.start));
+                            , entry.start, entry.size, tft.gzipped);
     }
 
     case vs::TileFile::atlas: {
-        // read sub-file table from stream
-        auto table(vts::Atlas::readTable(*is, is->name()));
-
         if (subTileFile >= table.size()) {
             LOGTHROW(err1, vs::NoSuchFile)
                 << "Atlas index " << subTileFile
@@ -89,19 +265,13 @@ void tileFileStream(Sink &sink, const Location &location
     }
 
     case vs::TileFile::navtile: {
-        // read sub-file table from stream
-        auto entry(vts::NavTile::readTable(*is, is->name())
-                   [vts::NavTile::imageIndex()]);
-
+        const auto &entry(table[vts::NavTile::imageIndex()]);
         return sink.content(std::move(is), FileClass::data
                             , entry.start, entry.size);
     }
 
     default: break;
     }
-
-    // default handler
-    return sink.content(std::move(is), FileClass::data);
 }
 
 void varsConfiguration(boost::program_options::options_description &od
@@ -118,3 +288,95 @@ void varsConfiguration(boost::program_options::options_description &od
 
     vts2tdt::varsConfiguration(od, prefix, vars);
 }
+
+std::vector<const vs::SupportFile::Files*> templateSupportFiles()
+{
+    return { &vts::supportFiles, &vtslibs::vts0::supportFiles
+            , &vts2tdt::supportFiles };
+}
+
+void sendGzipped(Sink &sink, const Location &location
+                 , const SharedBuffer &data, Sink::FileInfo stat
+                 , const std::string &etag)
+{
+    stat.headers.emplace_back("Vary", "Accept-Encoding");
+
+    if (location.acceptsGzip) {
+        stat.headers.emplace_back("Content-Encoding", "gzip");
+        if (!etag.empty()) { stat.setETag(etag); }
+        return sink.content(data, stat);
+    }
+
+    auto plain(std::make_shared<const std::string>(gunzip(*data)));
+    if (!etag.empty()) {
+        stat.setETag(makeETag(plain->data(), plain->size()));
+    }
+    sink.content(plain, stat);
+}
+
+void sendService(Sink &sink, unsigned int service
+                 , const std::string &path, const std::string &query)
+{
+    const auto file(serviceCache.get
+                    (ServiceKey(service, path, query)
+                     , [&]() -> GeneratedFile
+    {
+        auto is(vts::service::generate(service, path, query));
+        const auto stat(is->stat());
+
+        std::ostringstream os;
+        os << is->get().rdbuf();
+        is->close();
+
+        GeneratedFile file;
+        file.data = std::make_shared<const std::string>(os.str());
+        file.contentType = stat.contentType;
+        // generated content is stable for the life of the process
+        file.lastModified = std::time(nullptr);
+        file.etag = makeETag(file.data->data(), file.data->size());
+        return file;
+    }));
+
+    // NB: cached entry can be evicted while being sent -> keep data alive
+    // via shared buffer
+    sink.content(file.data
+                 , Sink::FileInfo(file.contentType, file.lastModified)
+                 .setFileClass(FileClass::registry).setETag(file.etag));
+}
+
+void sendRegistryFile(Sink &sink, const vr::DataFile &df)
+{
+    const auto file([&]() -> GeneratedFile
+    {
+        {
+            std::lock_guard<std::mutex> guard(registryFiles.mutex);
+            auto ffiles(registryFiles.files.find(df.path));
+            if (ffiles != registryFiles.files.end()) { return ffiles->second; }
+        }
+
+        // load file outside lock
+        auto is(vs::fileIStream(df.contentType, df.path));
+        const auto stat(is->stat());
+
+        std::ostringstream os;
+        os << is->get().rdbuf();
+        is->close();
+
+        GeneratedFile file;
+        file.data = std::make_shared<const std::string>(os.str());
+        file.contentType = stat.contentType;
+        file.lastModified = stat.lastModified;
+        file.etag = makeETag(file.data->data(), file.data->size());
+
+        // first one wins
+        std::lock_guard<std::mutex> guard(registryFiles.mutex);
+        return registryFiles.files.insert
+            (std::make_pair(df.path, file)).first->second;
+    }());
+
+    // NB: registry files are never released -> no need to copy
+    sink.content(file.data->data(), file.data->size()
+                 , Sink::FileInfo(file.contentType, file.lastModified)
+                 .setFileClass(FileClass::registry).setETag(file.etag)
+                 , false);
+}
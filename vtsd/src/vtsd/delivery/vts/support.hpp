@@ -27,14 +27,108 @@
 #ifndef vtsd_delivery_vts_driver_hpp_included_
 #define vtsd_delivery_vts_driver_hpp_included_
 
+#include <string>
+#include <vector>
+
 #include "../driver.hpp"
 
 #include "vts-libs/storage/streams.hpp"
+#include "vts-libs/vts/multifile.hpp"
+#include "vts-libs/registry.hpp"
+
+#include "../../lrucache.hpp"
+
+/** Parsed sub-file table of mesh/atlas/navtile file.
+ */
+struct TileFileTable {
+    vtslibs::vts::multifile::Table table;
+
+    /** Is payload gzipped? Valid only for meshes.
+     */
+    bool gzipped;
+
+    TileFileTable() : gzipped(false) {}
+};
+
+typedef std::pair<vtslibs::vts::TileId, vtslibs::storage::TileFile>
+    TileFileTableKey;
+
+/** Per-driver cache of parsed sub-file tables.
+ */
+class TileFileTableCache : public LruCache<TileFileTableKey, TileFileTable> {
+public:
+    typedef std::shared_ptr<TileFileTableCache> pointer;
+
+    TileFileTableCache(std::size_t capacity = (1 << 16))
+        : LruCache<TileFileTableKey, TileFileTable>(capacity)
+    {}
+};
+
+/** Returns sub-file table for given tile file (mesh/atlas/navtile only).
+ *  Table is looked up in/stored to tableCache if non-null.
+ */
+TileFileTable tileFileTable(const FileInfo &info
+                            , const vtslibs::vts::TileId &tileId
+                            , const vtslibs::storage::IStream::pointer &is
+                            , TileFileTableCache *tableCache = nullptr);
+
+/** Tile file content as served to the client.
+ */
+struct TileFilePayload {
+    std::string data;
+    bool gzipped;
+    std::time_t lastModified;
+
+    TileFilePayload() : gzipped(false), lastModified(-1) {}
+};
+
+/** Reads tile file content (i.e. sub-file of mesh/atlas/navtile, whole file
+ *  otherwise) from stream into memory. Stream is closed afterwards.
+ */
+TileFilePayload tileFilePayload(const FileInfo &info
+                                , unsigned int subTileFile
+                                , const vtslibs::vts::TileId &tileId
+                                , const vtslibs::storage::IStream::pointer &is
+                                , TileFileTableCache *tableCache = nullptr);
 
+/** Reads all sub-files of mesh/atlas/navtile file from stream into memory.
+ *  Stream is closed afterwards.
+ */
+std::vector<std::string>
+tileSubFiles(const FileInfo &info, const vtslibs::vts::TileId &tileId
+             , const vtslibs::storage::IStream::pointer &is
+             , TileFileTableCache *tableCache = nullptr);
+
+/** Sends tile file from stream. Mesh, atlas and navtile files are sent as a
+ *  single sub-file extracted via file's table. Table is looked up in/stored to
+ *  tableCache if non-null.
+ */
 void tileFileStream(Sink &sink, const Location &location
                     , const FileInfo &info
                     , unsigned int subTileFile
                     , const vtslibs::vts::TileId &tileId
-                    , vtslibs::storage::IStream::pointer &&is);
+                    , vtslibs::storage::IStream::pointer &&is
+                    , TileFileTableCache *tableCache = nullptr);
+
+/** Sends generated gzip-compressed content. Content is decompressed if the
+ *  client does not accept gzip encoding. Adds Vary: Accept-Encoding. Non-empty
+ *  etag is used as is for compressed content and recomputed otherwise.
+ */
+void sendGzipped(Sink &sink, const Location &location
+                 , const SharedBuffer &data, Sink::FileInfo stat
+                 , const std::string &etag = {});
+
+/** Sends output of local service. Generated output is memoized (bounded
+ *  cache keyed by service, path and query) and served with stable
+ *  Last-Modified and ETag.
+ */
+void sendService(Sink &sink, unsigned int service
+                 , const std::string &path, const std::string &query);
+
+/** Sends registry data file. File is loaded once and then kept in memory for
+ *  the life of the process; since it is never released it is handed to
+ *  libhttp as static data (no copy) with a strong ETag.
+ */
+void sendRegistryFile(Sink &sink, const vtslibs::registry::DataFile &file);
 
 #endif // vtsd_delivery_vts_driver_hpp_included_
@@ -24,7 +24,8 @@
  * POSSIBILITY OF SUCH DAMAGE.
  */
 
-#include "utility/gzipper.hpp"
+#include <sstream>
+#include <algorithm>
 
 #include "vts-libs/vts/tileset/driver.hpp"
 
@@ -35,6 +36,7 @@
 #include "tdt2vts.hpp"
 #include "tdt2vts/support.hpp"
 #include "tdt2vts/metabuilder.hpp"
+#include "tdt2vts/glb.hpp"
 #include "tdt2vts/constants.hpp"
 
 namespace fs = boost::filesystem;
@@ -61,6 +63,14 @@ struct FileInfo : ::FileInfo {
      */
     unsigned int subTileFile = 0;
 
+    /** Implicit tiling subtree file. Valid only for TileFile::meta.
+     */
+    bool subtree = false;
+
+    /** GLB mesh content. Valid only for TileFile::mesh.
+     */
+    bool glb = false;
+
     FileInfo(const std::string &path, const LocationConfig &config);
 };
 
@@ -82,6 +92,20 @@ FileInfo::FileInfo(const std::string &p, const LocationConfig &config)
                 tileFile = vts::TileFile::mesh;
                 return;
             }
+        } else if (constants::GlbExt == ext) {
+            if (!stf) {
+                type = Type::tileFile;
+                tileFile = vts::TileFile::mesh;
+                glb = true;
+                return;
+            }
+        } else if (constants::SubtreeExt == ext) {
+            if (!stf) {
+                type = Type::tileFile;
+                tileFile = vts::TileFile::meta;
+                subtree = true;
+                return;
+            }
         } else if (constants::JpegExt == ext) {
             if (stf) { // sub-tilefile mandatory
                 type = Type::tileFile;
@@ -117,24 +141,33 @@ FileInfo::FileInfo(const std::string &p, const LocationConfig &config)
     }
 }
 
-void finishMeta(Sink &sink, const Location &location, MetaBuilder &mb)
+void finishMeta(Sink &sink, const Location &location
+                , const CompressionConfig &compression
+                , LocationConfig::TdtContent content, MetaBuilder &mb
+                , TilesetCache &tilesetCache, const TilesetCacheKey &key)
 {
-    auto &delivery(mb.delivery());
-
-    tdt::Tileset ts;
-    if (!mb.run(ts)) {
+    std::ostringstream os;
+    if (!mb.run(os, content)) {
         return sink.error(utility::makeError<NotFound>
                           ("No metanodes in this subtree."));
     }
-    mb.send(sink, location, ts, vs::File::config, FileClass::data
-            , delivery.lastModified());
+
+    const SerializedTileset serialized(os.str(), mb.delivery().lastModified()
+                                       , compression);
+    tilesetCache.put(key, serialized);
+    serialized.send(sink, location, FileClass::data);
 }
 
 void generateMeta(Sink &sink, const Location &location
+                  , const LocationConfig &config
                   , const ErrorHandler::pointer &errorHandler
+                  , DeliveryCache &cache
                   , const vts::Delivery::pointer &delivery
                   , const vr::ReferenceFrame &referenceFrame
                   , const PerThreadConvertors::pointer &convertors
+                  , const SubtreeIndex::pointer &subtrees
+                  , const RegionCache::pointer &regions
+                  , const TilesetCache::pointer &tilesetCache
                   , const vts::TileId &rootId)
 {
     // we need to load metatile pyramid starting at rootId
@@ -145,68 +178,128 @@ void generateMeta(Sink &sink, const Location &location
                           ("Not a metanode pyramid root."));
     }
 
-    if (!delivery->async()) {
-        MetaBuilder mb(delivery, referenceFrame, convertors, rootId);
-        mb.load();
-        return finishMeta(sink, location, mb);
+    const TilesetCacheKey key(TilesetKind::meta, rootId, config.tdtContent
+                              , config.compression);
+    if (const auto serialized = tilesetCache->get(key)) {
+        return serialized->send(sink, location, FileClass::data);
     }
 
-    MetaBuilder::load_async(std::make_shared<MetaBuilder>
-                            (delivery, referenceFrame, convertors, rootId)
-                            , errorHandler
-                            , [=](MetaBuilder &mb) mutable
+    MetaBuilder::load(std::make_shared<MetaBuilder>
+                      (delivery, referenceFrame, convertors, subtrees
+                       , regions, rootId)
+                      , cache, errorHandler
+                      , [=, compression{config.compression}
+                         , content{config.tdtContent}]
+                      (MetaBuilder &mb) mutable
     {
-        try {
-            finishMeta(sink, location, mb);
-        } catch (...) {
-            (*errorHandler)();
-        }
+        finishMeta(sink, location, compression, content, mb
+                   , *tilesetCache, key);
     });
 }
 
-void finishTileset(Sink &sink, const Location &location
-                   , const LocationConfig &config, MetaBuilder &mb)
+void finishSubtree(Sink &sink, const Location &location
+                   , const CompressionConfig &compression, MetaBuilder &mb
+                   , TilesetCache &tilesetCache, const TilesetCacheKey &key)
+{
+    std::ostringstream os;
+    if (!mb.runSubtree(os)) {
+        return sink.error(utility::makeError<NotFound>
+                          ("No tiles in this subtree."));
+    }
+
+    const SerializedTileset serialized(os.str(), mb.delivery().lastModified()
+                                       , compression
+                                       , "application/octet-stream");
+    tilesetCache.put(key, serialized);
+    serialized.send(sink, location, FileClass::data);
+}
+
+void generateSubtree(Sink &sink, const Location &location
+                     , const LocationConfig &config
+                     , const ErrorHandler::pointer &errorHandler
+                     , DeliveryCache &cache
+                     , const vts::Delivery::pointer &delivery
+                     , const vr::ReferenceFrame &referenceFrame
+                     , const PerThreadConvertors::pointer &convertors
+                     , const SubtreeIndex::pointer &subtrees
+                     , const RegionCache::pointer &regions
+                     , const TilesetCache::pointer &tilesetCache
+                     , const vts::TileId &rootId)
 {
-    auto &delivery(mb.delivery());
+    if (!config.enableImplicitTiling) {
+        return sink.error(utility::makeError<NotFound>
+                          ("Implicit tiling disabled."));
+    }
 
-    tdt::Tileset ts;
-    if (!mb.run(ts)) {
+    // subtree spans whole metatile stack
+    if (rootId.lod % subtreeLevels(referenceFrame)) {
         return sink.error(utility::makeError<NotFound>
-                          ("No metanodes in this subtree."));
+                          ("Not an implicit subtree root."));
+    }
+
+    const TilesetCacheKey key(TilesetKind::subtree, rootId, config.tdtContent
+                              , config.compression);
+    if (const auto serialized = tilesetCache->get(key)) {
+        return serialized->send(sink, location, FileClass::data);
     }
 
-    // use revision as tileset version
-    ts.asset.tilesetVersion
-        = utility::format("%s", delivery.properties().revision);
+    MetaBuilder::load(std::make_shared<MetaBuilder>
+                      (delivery, referenceFrame, convertors, subtrees
+                       , regions, rootId)
+                      , cache, errorHandler
+                      , [=, compression{config.compression}]
+                      (MetaBuilder &mb) mutable
+    {
+        finishSubtree(sink, location, compression, mb, *tilesetCache, key);
+    });
+}
+
+void finishTileset(Sink &sink, const Location &location
+                   , const LocationConfig &config, MetaBuilder &mb
+                   , TilesetCache &tilesetCache, const TilesetCacheKey &key)
+{
+    // NB: revision is used as tileset version
+    std::ostringstream os;
+    if (!(config.enableImplicitTiling
+          ? mb.runImplicit(os, config.tdtContent)
+          : mb.run(os, config.tdtContent)))
+    {
+        return sink.error(utility::makeError<NotFound>
+                          ("No metanodes in this subtree."));
+    }
 
-    mb.send(sink, location, ts, vs::File::config, config.configClass
-            , delivery.lastModified());
+    const SerializedTileset serialized(os.str(), mb.delivery().lastModified()
+                                       , config.compression);
+    tilesetCache.put(key, serialized);
+    serialized.send(sink, location, config.configClass);
 }
 
 void generateTileset(Sink &sink, const Location &location
                      , const LocationConfig &config
                      , const ErrorHandler::pointer &errorHandler
+                     , DeliveryCache &cache
                      , const vts::Delivery::pointer &delivery
                      , const vr::ReferenceFrame &referenceFrame
-                     , const PerThreadConvertors::pointer &convertors)
+                     , const PerThreadConvertors::pointer &convertors
+                     , const SubtreeIndex::pointer &subtrees
+                     , const RegionCache::pointer &regions
+                     , const TilesetCache::pointer &tilesetCache)
 {
-    if (!delivery->async()) {
-        MetaBuilder mb(delivery, referenceFrame, convertors, {}, false);
-        mb.load(0);
-        return finishTileset(sink, location, config, mb);
+    const TilesetCacheKey key(config.enableImplicitTiling
+                              ? TilesetKind::implicitTileset
+                              : TilesetKind::tileset
+                              , {}, config.tdtContent, config.compression);
+    if (const auto serialized = tilesetCache->get(key)) {
+        return serialized->send(sink, location, config.configClass);
     }
 
-    MetaBuilder::load_async(std::make_shared<MetaBuilder>
-                            (delivery, referenceFrame, convertors
-                             , vts::TileId(), false)
-                            , errorHandler
-                            , [=](MetaBuilder &mb) mutable
+    MetaBuilder::load(std::make_shared<MetaBuilder>
+                      (delivery, referenceFrame, convertors, subtrees
+                       , regions, vts::TileId(), false)
+                      , cache, errorHandler
+                      , [=](MetaBuilder &mb) mutable
     {
-        try {
-            finishTileset(sink, location, config, mb);
-        } catch (...) {
-            (*errorHandler)();
-        }
+        finishTileset(sink, location, config, mb, *tilesetCache, key);
     }, 0);
 }
 
@@ -252,18 +345,105 @@ private:
     const vts::Mesh &mesh_;
 };
 
+void sendMesh(Sink &sink, const Location &location, MeshFormat format
+              , const MeshCache::Mesh &mesh)
+{
+    Sink::FileInfo stat(((format == MeshFormat::b3dm)
+                         ? vs::contentType(vs::TileFile::mesh)
+                         : "model/gltf-binary")
+                        , mesh.lastModified);
+    stat.setFileClass(FileClass::data);
+    sendGzipped(sink, location, mesh.data, stat);
+}
+
+/** Converts serialized b3dm tile to requested format, compresses, caches and
+ *  sends it.
+ */
+void finishMesh(Sink &sink, const Location &location
+                , const CompressionConfig &compression, MeshFormat format
+                , const MeshCache::pointer &meshCache
+                , const vts::TileId &tileId, const std::string &b3dm
+                , std::time_t lastModified
+                , const EmbeddedImages &images = EmbeddedImages())
+{
+    const MeshCache::Mesh converted
+        (std::make_shared<const std::string>
+         (gzip(((format == MeshFormat::b3dm) ? b3dm : b3dm2glb(b3dm, images))
+               , compression))
+         , lastModified);
+    if (meshCache) {
+        meshCache->put(tileId, format, compression, converted);
+    }
+
+    sendMesh(sink, location, format, converted);
+}
+
+/** Loads tile's atlas and finishes mesh with atlas textures embedded.
+ */
+void embedAtlas(Sink &sink, const Location &location
+                , const CompressionConfig &compression
+                , const vts::Delivery &delivery
+                , ErrorHandler::pointer errorHandler
+                , MeshCache::pointer meshCache
+                , TileFileTableCache::pointer tableCache
+                , const vts::TileId &tileId, std::string b3dm
+                , std::time_t lastModified)
+{
+    delivery.input(tileId, vs::TileFile::atlas, vts::FileFlavor::raw
+                   , [=, errorHandler{std::move(errorHandler)}
+                      , meshCache{std::move(meshCache)}
+                      , tableCache{std::move(tableCache)}
+                      , b3dm{std::move(b3dm)}]
+                   (const vts::EIStream &eis) mutable
+    {
+        if (auto is = eis.get(*errorHandler)) {
+            try {
+                const auto atlasModified(is->stat().lastModified);
+
+                ::FileInfo info(location.path);
+                info.tileFile = vs::TileFile::atlas;
+
+                // atlas image i is referenced by ImageUriSource for submesh i
+                const auto textures(tileSubFiles(info, tileId, is
+                                                 , tableCache.get()));
+                EmbeddedImages images;
+                for (std::size_t i(0), e(textures.size()); i != e; ++i) {
+                    images[filename(tileId, constants::JpegExt, int(i))]
+                        = textures[i];
+                }
+
+                finishMesh(sink, location, compression
+                           , MeshFormat::glbEmbedded, meshCache, tileId, b3dm
+                           , std::max(lastModified, atlasModified), images);
+            } catch (...) {
+                (*errorHandler)();
+            }
+        }
+    });
+}
+
 void generateMesh(Sink &sink, const Location &location
-                  , const vts::Delivery &delivery
+                  , const CompressionConfig &compression, MeshFormat format
+                  , const vts::Delivery::pointer &delivery
                   , ErrorHandler::pointer errorHandler
                   , PerThreadConvertors::pointer ptc
+                  , MeshCache::pointer meshCache
+                  , TileFileTableCache::pointer tableCache
                   , const vts::TileId &tileId)
 {
+    if (meshCache) {
+        if (const auto mesh = meshCache->get(tileId, format, compression)) {
+            return sendMesh(sink, location, format, mesh);
+        }
+    }
+
     // run asynchronously
-    delivery.driver()->input
+    delivery->driver()->input
         (tileId, vs::TileFile::mesh
-         , [&, sink{std::move(sink)}, location
+         , [sink{std::move(sink)}, location, compression, format, delivery
             , errorHandler{std::move(errorHandler)}
-            , ptc{std::move(ptc)}]
+            , ptc{std::move(ptc)}, meshCache{std::move(meshCache)}
+            , tableCache{std::move(tableCache)}, tileId]
          (const vts::EIStream &eis)
          mutable -> void
     {
@@ -273,24 +453,37 @@ void generateMesh(Sink &sink, const Location &location
 
                 // convert from physical system to destination, if different
                 // than destination system
-                const auto &fromPhys(ptc->get()());
-                if (fromPhys) {
-                    for (auto &sm : mesh) {
-                        for (auto &v : sm.vertices) { v = fromPhys(v); }
-                    }
-                }
+                const auto convertors(ptc->get());
+                for (auto &sm : mesh) { convertors.convert(sm.vertices); }
 
                 // serialize, use external URIs to images
-                auto io(std::make_shared<vs::StringIStream>
-                        (vs::TileFile::mesh, location.path
-                         , is->stat().lastModified));
-
-                tdt::saveTile(utility::Gzipper(io->sink()), location.path
+                std::ostringstream os;
+                tdt::saveTile(os, location.path
                               , tileId, vts::ConstSubMeshRange(mesh.submeshes)
                               , ImageUriSource(tileId, mesh));
-                io->updateSize();
 
-                return sink.content(io, FileClass::data, true);
+                const auto lastModified(is->stat().lastModified);
+
+                const auto internal(std::any_of
+                                    (mesh.submeshes.begin()
+                                     , mesh.submeshes.end()
+                                     , [](const vts::SubMesh &sm)
+                {
+                    return (sm.textureMode
+                            == vts::SubMesh::TextureMode::internal);
+                }));
+
+                if ((format != MeshFormat::glbEmbedded) || !internal) {
+                    // nothing to embed
+                    return finishMesh(sink, location, compression, format
+                                      , meshCache, tileId, os.str()
+                                      , lastModified);
+                }
+
+                // images are embedded, load atlas
+                embedAtlas(sink, location, compression, *delivery
+                           , errorHandler, meshCache, tableCache, tileId
+                           , os.str(), lastModified);
             } catch (...) {
                 (*errorHandler)();
             }
@@ -301,7 +494,8 @@ void generateMesh(Sink &sink, const Location &location
 void generateAtlas(Sink &sink, const Location &location
                    , const ErrorHandler::pointer &errorHandler
                    , const vts::Delivery &delivery
-                   , const FileInfo &fileInfo)
+                   , const FileInfo &fileInfo
+                   , const TileFileTableCache::pointer &tableCache)
 {
     // run asynchronously
     delivery.input(fileInfo.tileId, fileInfo.tileFile
@@ -313,7 +507,7 @@ void generateAtlas(Sink &sink, const Location &location
             try {
                 tileFileStream(sink, location, fileInfo
                                , fileInfo.subTileFile, fileInfo.tileId
-                               , std::move(is));
+                               , std::move(is), tableCache.get());
             } catch (...) {
                 (*errorHandler)();
             }
@@ -323,12 +517,25 @@ void generateAtlas(Sink &sink, const Location &location
 
 } // namespace vts2tdt
 
-Tdt2VtsTileSet::Tdt2VtsTileSet(const vts::Delivery::pointer &delivery)
+Tdt2VtsTileSet::Tdt2VtsTileSet(const vts::Delivery::pointer &delivery
+                               , const fs::path &path
+                               , const vts2tdt::MeshCacheOptions &meshCache
+                               , const vts2tdt::RegionCacheOptions
+                               &regionCache
+                               , DeliveryCache &cache)
     : delivery_(delivery)
     , referenceFrame_(vr::system.referenceFrames
                       (delivery_->properties().referenceFrame))
     , convertors_(std::make_shared<vts2tdt::PerThreadConvertors>
                   (referenceFrame_))
+    , tableCache_(std::make_shared<TileFileTableCache>())
+    , subtrees_(std::make_shared<vts2tdt::SubtreeIndex>
+                (delivery_->index().tileIndex))
+    , regions_(std::make_shared<vts2tdt::RegionCache>(regionCache))
+    , tilesetCache_(std::make_shared<vts2tdt::TilesetCache>())
+    , meshCache_(vts2tdt::MeshCache::create
+                 (meshCache, path, delivery_->properties().revision))
+    , cache_(cache)
 {
 }
 
@@ -347,26 +554,43 @@ void Tdt2VtsTileSet::handle(Sink sink, const Location &location
             }
 
             return vts2tdt::generateTileset(sink, location, config
-                                            , errorHandler
+                                            , errorHandler, cache_
                                             , delivery_, referenceFrame_
-                                            , convertors_);
+                                            , convertors_, subtrees_
+                                            , regions_, tilesetCache_);
 
         case FileInfo::Type::tileFile:
             switch (info.tileFile) {
             case vs::TileFile::meta:
-                return vts2tdt::generateMeta(sink, location, errorHandler
+                if (info.subtree) {
+                    return vts2tdt::generateSubtree
+                        (sink, location, config, errorHandler, cache_
+                         , delivery_, referenceFrame_, convertors_
+                         , subtrees_, regions_, tilesetCache_
+                         , info.tileId);
+                }
+
+                return vts2tdt::generateMeta(sink, location, config
+                                             , errorHandler, cache_
                                              , delivery_, referenceFrame_
-                                             , convertors_, info.tileId);
+                                             , convertors_, subtrees_
+                                             , regions_, tilesetCache_
+                                             , info.tileId);
 
             case vs::TileFile::mesh:
-                return vts2tdt::generateMesh(sink, location, *delivery_
-                                             , errorHandler
-                                             , convertors_
-                                             , info.tileId);
+                return vts2tdt::generateMesh
+                    (sink, location, config.compression
+                     , (!info.glb ? vts2tdt::MeshFormat::b3dm
+                        : (config.tdtEmbedTextures
+                           ? vts2tdt::MeshFormat::glbEmbedded
+                           : vts2tdt::MeshFormat::glb))
+                     , delivery_, errorHandler, convertors_, meshCache_
+                     , tableCache_, info.tileId);
 
             case vs::TileFile::atlas:
                 return vts2tdt::generateAtlas(sink, location, errorHandler
-                                              , *delivery_, info);
+                                              , *delivery_, info
+                                              , tableCache_);
 
             default: break;
             }
@@ -32,12 +32,19 @@
 
 #include "../driver.hpp"
 
+#include "support.hpp"
 #include "tdt2vts/convertors.hpp"
+#include "tdt2vts/meshcache.hpp"
+#include "tdt2vts/metabuilder.hpp"
 
 class Tdt2VtsTileSet : public DriverWrapper
 {
 public:
-    Tdt2VtsTileSet(const vtslibs::vts::Delivery::pointer &delivery);
+    Tdt2VtsTileSet(const vtslibs::vts::Delivery::pointer &delivery
+                   , const boost::filesystem::path &path
+                   , const vts2tdt::MeshCacheOptions &meshCache
+                   , const vts2tdt::RegionCacheOptions &regionCache
+                   , DeliveryCache &cache);
 
     virtual vs::Resources resources() const {
         return delivery_->resources();
@@ -61,6 +68,30 @@ private:
     /** CS convertor cache
      */
     vts2tdt::PerThreadConvertors::pointer convertors_;
+
+    /** Cache of parsed sub-file tables.
+     */
+    TileFileTableCache::pointer tableCache_;
+
+    /** Memoized subtree extents.
+     */
+    vts2tdt::SubtreeIndex::pointer subtrees_;
+
+    /** Cache of node regions.
+     */
+    vts2tdt::RegionCache::pointer regions_;
+
+    /** Cache of generated tileset.json and metatile JSONs.
+     */
+    vts2tdt::TilesetCache::pointer tilesetCache_;
+
+    /** Cache of converted meshes, null if disabled.
+     */
+    vts2tdt::MeshCache::pointer meshCache_;
+
+    /** Delivery cache, its workers run background jobs.
+     */
+    DeliveryCache &cache_;
 };
 
 #endif // vtsd_delivery_vts_3dtiles_hpp_included_
@@ -34,7 +34,9 @@ namespace vts2tdt {
 namespace constants {
     const std::string JsonExt("json");
     const std::string B3dmExt("b3dm");
+    const std::string GlbExt("glb");
     const std::string JpegExt("jpg");
+    const std::string SubtreeExt("subtree");
 }
 
 } // namespace vts2tdt
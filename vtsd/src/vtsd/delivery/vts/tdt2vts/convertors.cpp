@@ -24,6 +24,12 @@
  * POSSIBILITY OF SUCH DAMAGE.
  */
 
+#include <cmath>
+
+#include <boost/algorithm/string/predicate.hpp>
+
+#include <ogr_spatialref.h>
+
 #include "dbglog/dbglog.hpp"
 
 #include "../../../error.hpp"
@@ -32,9 +38,63 @@
 
 namespace vts = vtslibs::vts;
 namespace vr = vtslibs::registry;
+namespace ba = boost::algorithm;
 
 namespace vts2tdt {
 
+namespace {
+
+/** Returns closed-form conversion if srsDef is plain geographic system in
+ *  degrees with ellipsoidal heights, i.e. geocentric conversion on its own
+ *  ellipsoid is exact.
+ */
+boost::optional<GeographicToGeocentric>
+geographicToGeocentric(const geo::SrsDefinition &srsDef)
+{
+    // only plain proj.4 definitions without any grids (geoid or datum shift)
+    if ((srsDef.type != geo::SrsDefinition::Type::proj4)
+        || ba::contains(srsDef.srs, "grids"))
+    {
+        return boost::none;
+    }
+
+    const auto ref(srsDef.reference());
+    if (!ref.IsGeographic()) { return boost::none; }
+
+    // degrees only
+    if (std::abs(ref.GetAngularUnits() - M_PI / 180.0) > 1e-12) {
+        return boost::none;
+    }
+
+    // NB: inverse flattening is zero for spheres
+    const auto a(ref.GetSemiMajor());
+    const auto inv(ref.GetInvFlattening());
+    const auto f(inv ? 1.0 / inv : 0.0);
+    return GeographicToGeocentric{a, f * (2.0 - f)};
+}
+
+} // namespace
+
+void GeographicToGeocentric::operator()(math::Points3 &points) const
+{
+    constexpr double deg2rad(M_PI / 180.0);
+    const double b2(1.0 - e2);
+
+    for (auto &p : points) {
+        const double lon(p(0) * deg2rad);
+        const double lat(p(1) * deg2rad);
+        const double h(p(2));
+
+        const double slat(std::sin(lat));
+        const double clat(std::cos(lat));
+        const double n(a / std::sqrt(1.0 - e2 * slat * slat));
+
+        p(0) = (n + h) * clat * std::cos(lon);
+        p(1) = (n + h) * clat * std::sin(lon);
+        p(2) = (n * b2 + h) * slat;
+    }
+}
+
 PerThreadConvertors::PerThreadConvertors(const vr::ReferenceFrame &rf)
     : physical_(rf.model.physicalSrs)
 {
@@ -54,6 +114,10 @@ PerThreadConvertors::PerThreadConvertors(const vr::ReferenceFrame &rf)
 
     if (physical.type != vr::Srs::Type::cartesian) {
         world_ = geo::geocentric(physical.srsDef);
+
+        if (physical.type == vr::Srs::Type::geographic) {
+            fromPhys_ = geographicToGeocentric(physical.srsDef);
+        }
     }
 
     region_ = geo::setAngularUnit(geo::geographic(region.srsDef)
@@ -63,7 +127,8 @@ PerThreadConvertors::PerThreadConvertors(const vr::ReferenceFrame &rf)
 Convertors PerThreadConvertors::get()
     const
 {
-    if (auto csMap = csMap_.get()) { return csMap; }
+    const auto *fromPhys(fromPhys_.get_ptr());
+    if (auto csMap = csMap_.get()) { return { csMap, fromPhys }; }
 
     // new thread -> initialize mapping
     auto csMap(new CsMap());
@@ -83,7 +148,7 @@ Convertors PerThreadConvertors::get()
             (CsMap::value_type(srs, vts::CsConvertor(srs, region_)));
     }
 
-    return csMap;
+    return { csMap, fromPhys };
 }
 
 const vts::CsConvertor& Convertors::get(const std::string &srsId) const
@@ -97,4 +162,14 @@ const vts::CsConvertor& Convertors::get(const std::string &srsId) const
     return fcsMap->second;
 }
 
+void Convertors::convert(math::Points3 &points, const std::string &srsId)
+    const
+{
+    if (fromPhys_ && srsId.empty()) { return (*fromPhys_)(points); }
+
+    const auto &conv(get(srsId));
+    if (!conv) { return; }
+    for (auto &p : points) { p = conv(p); }
+}
+
 } // namespace vts2tdt
@@ -30,25 +30,60 @@
 #include <new>
 #include <map>
 
+#include <boost/optional.hpp>
 #include <boost/thread/tss.hpp>
 
+#include "math/geometry_core.hpp"
+
 #include "vts-libs/vts/csconvertor.hpp"
 
 namespace vts2tdt {
 
 using CsMap = std::map<std::string, vtslibs::vts::CsConvertor>;
 
+/** Closed-form geographic (lon/lat in degrees, ellipsoidal height) to
+ *  geocentric conversion on the same ellipsoid. Used instead of generic
+ *  convertor for physical -> 3D Tiles conversion when reference frame's
+ *  physical SRS is a plain geographic system (a rare setup: physical SRS is
+ *  usually geocentric already and no conversion is needed at all).
+ */
+struct GeographicToGeocentric {
+    /** Semi-major axis.
+     */
+    double a;
+
+    /** Squared first eccentricity.
+     */
+    double e2;
+
+    void operator()(math::Points3 &points) const;
+};
+
 class Convertors {
 public:
-    Convertors(const CsMap *csMap) : csMap_(csMap) {}
+    Convertors(const CsMap *csMap
+               , const GeographicToGeocentric *fromPhys = nullptr)
+        : csMap_(csMap), fromPhys_(fromPhys)
+    {}
 
     const vtslibs::vts::CsConvertor& get(const std::string &srsId = {}) const;
 
     const vtslibs::vts::CsConvertor& operator()(const std::string &srsId = {})
         const { return get(srsId); }
 
+    /** Converts all points in place. Physical -> 3D Tiles conversion uses
+     *  GeographicToGeocentric when available; everything else (including
+     *  any named SRS) is converted point by point by generic convertor.
+     *
+     *  NB: there is no physical -> 3D Tiles conversion (i.e. this is a
+     *  no-op) when physical SRS is geocentric already.
+     */
+    void convert(math::Points3 &points, const std::string &srsId = {})
+        const;
+
 private:
     const CsMap *csMap_;
+    const GeographicToGeocentric *fromPhys_;
 };
 
 /** Holds per-thread convertors for converting VTS data to 3DTiles.
@@ -80,6 +115,10 @@ private:
      */
     geo::SrsDefinition region_;
 
+    /** Closed-form physical -> world conversion, if applicable.
+     */
+    boost::optional<GeographicToGeocentric> fromPhys_;
+
     /** Cached convertors.
      */
     mutable boost::thread_specific_ptr<CsMap> csMap_;
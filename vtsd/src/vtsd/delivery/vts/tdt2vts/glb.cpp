@@ -0,0 +1,249 @@
+/**
+ * Copyright (c) 2021 Melown Technologies SE
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * *  Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * *  Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <cstring>
+#include <algorithm>
+#include <cstdint>
+#include <sstream>
+
+#include "dbglog/dbglog.hpp"
+
+#include "jsoncpp/json.hpp"
+#include "jsoncpp/io.hpp"
+
+#include "../../../error.hpp"
+
+#include "glb.hpp"
+
+namespace vts2tdt {
+
+namespace {
+
+const std::uint32_t GlbMagic(0x46546c67); // "glTF"
+const std::uint32_t ChunkJson(0x4e4f534a); // "JSON"
+const std::uint32_t ChunkBin(0x004e4942); // "BIN\0"
+
+const std::size_t B3dmHeaderSize(28);
+
+std::uint32_t read32(const std::string &data, std::size_t offset)
+{
+    if (offset + 4 > data.size()) {
+        LOGTHROW(err1, FormatError) << "Truncated tile content.";
+    }
+
+    std::uint32_t value(0);
+    for (int i(3); i >= 0; --i) {
+        value = (value << 8) | std::uint8_t(data[offset + i]);
+    }
+    return value;
+}
+
+void write32(std::string &out, std::uint32_t value)
+{
+    for (int i(0); i < 4; ++i) {
+        out.push_back(char(value & 0xff));
+        value >>= 8;
+    }
+}
+
+double readDouble(const std::string &data, std::size_t offset)
+{
+    const std::uint64_t raw((std::uint64_t(read32(data, offset + 4)) << 32)
+                            | read32(data, offset));
+    double value;
+    std::memcpy(&value, &raw, sizeof(value));
+    return value;
+}
+
+void pad(std::string &out, char c)
+{
+    while (out.size() % 4) { out.push_back(c); }
+}
+
+Json::Value parse(const std::string &data, std::size_t offset
+                  , std::size_t size, const char *what)
+{
+    Json::Value value;
+    Json::Reader reader;
+    const auto *begin(data.data() + offset);
+    if (!reader.parse(begin, begin + size, value, false)) {
+        LOGTHROW(err1, FormatError)
+            << "Unable to parse " << what << ": "
+            << reader.getFormattedErrorMessages() << ".";
+    }
+    return value;
+}
+
+/** Reads RTC_CENTER from b3dm feature table, if present.
+ */
+bool rtcCenter(const std::string &b3dm, std::size_t offset
+               , std::size_t jsonSize, double center[3])
+{
+    if (!jsonSize) { return false; }
+
+    const auto ft(parse(b3dm, offset, jsonSize, "feature table"));
+    const auto &rtc(ft["RTC_CENTER"]);
+
+    if (rtc.isArray() && (rtc.size() == 3)) {
+        for (int i(0); i < 3; ++i) { center[i] = rtc[i].asDouble(); }
+        return true;
+    }
+
+    if (rtc.isObject() && rtc.isMember("byteOffset")) {
+        // stored in feature table binary body
+        const auto bin(offset + jsonSize + rtc["byteOffset"].asUInt());
+        for (int i(0); i < 3; ++i) {
+            center[i] = readDouble(b3dm, bin + 8 * i);
+        }
+        return true;
+    }
+
+    return false;
+}
+
+} // namespace
+
+std::string b3dm2glb(const std::string &b3dm, const EmbeddedImages &images)
+{
+    // b3dm header: magic, version, byteLength, then feature and batch table
+    // JSON and binary lengths
+    if ((b3dm.size() < B3dmHeaderSize) || b3dm.compare(0, 4, "b3dm")) {
+        LOGTHROW(err1, FormatError) << "Not a b3dm tile.";
+    }
+
+    const auto ftJson(read32(b3dm, 12));
+    const auto ftBin(read32(b3dm, 16));
+    const auto btJson(read32(b3dm, 20));
+    const auto btBin(read32(b3dm, 24));
+
+    double center[3];
+    const auto rtc(rtcCenter(b3dm, B3dmHeaderSize, ftJson, center));
+
+    // embedded GLB
+    const std::size_t glb(B3dmHeaderSize + ftJson + ftBin + btJson + btBin);
+    if (read32(b3dm, glb) != GlbMagic) {
+        LOGTHROW(err1, FormatError) << "No GLB in b3dm tile.";
+    }
+
+    const auto glbSize(std::min<std::size_t>(read32(b3dm, glb + 8)
+                                             , b3dm.size() - glb));
+
+    Json::Value gltf;
+    std::string bin;
+    for (std::size_t chunk(glb + 12), end(glb + glbSize); chunk + 8 <= end; )
+    {
+        const auto size(read32(b3dm, chunk));
+        const auto type(read32(b3dm, chunk + 4));
+        if (chunk + 8 + size > end) {
+            LOGTHROW(err1, FormatError) << "Truncated GLB chunk.";
+        }
+
+        if (type == ChunkJson) {
+            gltf = parse(b3dm, chunk + 8, size, "glTF JSON");
+        } else if (type == ChunkBin) {
+            bin.assign(b3dm, chunk + 8, size);
+        }
+        chunk += 8 + size;
+    }
+
+    if (!gltf.isObject()) {
+        LOGTHROW(err1, FormatError) << "No JSON chunk in GLB.";
+    }
+
+    if (rtc && gltf.isMember("scenes")) {
+        /* Tile content is Y-up and rotated to Z-up by the client while the
+         * RTC center is in Z-up (ECEF); put the center into a new root node
+         * in glTF (Y-up) coordinates: (x, y, z) -> (x, z, -y)
+         */
+        auto &scene(gltf["scenes"][gltf.get("scene", 0).asUInt()]);
+
+        Json::Value node(Json::objectValue);
+        node["children"] = scene["nodes"];
+        auto &translation(node["translation"] = Json::arrayValue);
+        translation.append(center[0]);
+        translation.append(center[2]);
+        translation.append(-center[1]);
+
+        auto &nodes(gltf["nodes"]);
+        scene["nodes"] = Json::arrayValue;
+        scene["nodes"].append(nodes.size());
+        nodes.append(node);
+    }
+
+    // embed images: replace URI with view into binary chunk
+    if (!images.empty() && gltf.isMember("images")) {
+        auto &views(gltf["bufferViews"]);
+        for (auto &image : gltf["images"]) {
+            if (!image.isMember("uri")) { continue; }
+            const auto fimages(images.find(image["uri"].asString()));
+            if (fimages == images.end()) { continue; }
+            const auto &data(fimages->second);
+
+            pad(bin, '\0');
+            Json::Value view(Json::objectValue);
+            view["buffer"] = 0;
+            view["byteOffset"] = Json::UInt64(bin.size());
+            view["byteLength"] = Json::UInt64(data.size());
+            bin.append(data);
+
+            image.removeMember("uri");
+            image["bufferView"] = views.size();
+            image["mimeType"] = "image/jpeg";
+            views.append(view);
+        }
+
+        auto &buffers(gltf["buffers"]);
+        if (!buffers.size()) { buffers.append(Json::objectValue); }
+        buffers[0]["byteLength"] = Json::UInt64(bin.size());
+    }
+
+    // serialize
+    std::ostringstream os;
+    Json::write(os, gltf, false);
+    auto json(os.str());
+    pad(json, ' ');
+    pad(bin, '\0');
+
+    std::string out;
+    out.reserve(12 + 8 + json.size() + 8 + bin.size());
+    write32(out, GlbMagic);
+    write32(out, 2);
+    write32(out, 12 + 8 + json.size() + (bin.empty() ? 0 : 8 + bin.size()));
+
+    write32(out, json.size());
+    write32(out, ChunkJson);
+    out.append(json);
+
+    if (!bin.empty()) {
+        write32(out, bin.size());
+        write32(out, ChunkBin);
+        out.append(bin);
+    }
+
+    return out;
+}
+
+} // namespace vts2tdt
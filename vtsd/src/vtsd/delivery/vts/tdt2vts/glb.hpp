@@ -0,0 +1,53 @@
+/**
+ * Copyright (c) 2021 Melown Technologies SE
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * *  Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * *  Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef vtsd_delivery_vts_vts2tdt_glb_hpp_included_
+#define vtsd_delivery_vts_vts2tdt_glb_hpp_included_
+
+#include <map>
+#include <string>
+
+namespace vts2tdt {
+
+/** Images to embed into GLB: image URI -> image (JPEG) data.
+ */
+typedef std::map<std::string, std::string> EmbeddedImages;
+
+/** Converts b3dm tile to binary glTF, i.e. 3D Tiles 1.1 content without the
+ *  b3dm wrapper.
+ *
+ *  Feature table's RTC_CENTER is moved to translation of a new scene root
+ *  node; batch table is dropped. Images whose URIs are listed in images are
+ *  embedded into GLB binary chunk.
+ *
+ *  Throws FormatError on malformed input.
+ */
+std::string b3dm2glb(const std::string &b3dm
+                     , const EmbeddedImages &images = EmbeddedImages());
+
+} // namespace vts2tdt
+
+#endif // vtsd_delivery_vts_vts2tdt_glb_hpp_included_
@@ -0,0 +1,234 @@
+/**
+ * Copyright (c) 2021 Melown Technologies SE
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * *  Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * *  Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <cstring>
+#include <sstream>
+
+#include "dbglog/dbglog.hpp"
+
+#include "../../../error.hpp"
+
+#include "implicit.hpp"
+
+namespace vts2tdt {
+
+const char *ImplicitSchema =
+    "{\"id\":\"vtsd\",\"classes\":{\"tile\":{\"properties\":{"
+    "\"boundingRegion\":{\"type\":\"SCALAR\",\"componentType\":\"FLOAT64\""
+    ",\"array\":true,\"count\":6,\"semantic\":\"TILE_BOUNDING_REGION\"}"
+    ",\"geometricError\":{\"type\":\"SCALAR\",\"componentType\":\"FLOAT64\""
+    ",\"semantic\":\"TILE_GEOMETRIC_ERROR\"}"
+    "}}}}";
+
+namespace {
+
+/** Interleaves bits of x (even bits) and y (odd bits).
+ */
+std::uint64_t morton(std::uint32_t x, std::uint32_t y)
+{
+    const auto spread([](std::uint64_t v) -> std::uint64_t
+    {
+        v &= 0xffffffff;
+        v = (v | (v << 16)) & 0x0000ffff0000ffffull;
+        v = (v | (v << 8)) & 0x00ff00ff00ff00ffull;
+        v = (v | (v << 4)) & 0x0f0f0f0f0f0f0f0full;
+        v = (v | (v << 2)) & 0x3333333333333333ull;
+        v = (v | (v << 1)) & 0x5555555555555555ull;
+        return v;
+    });
+    return spread(x) | (spread(y) << 1);
+}
+
+/** Index of first tile of given level in tile availability bitstream, i.e.
+ *  number of tiles in all upper levels: (4^level - 1) / 3
+ */
+std::uint64_t levelOffset(unsigned int level)
+{
+    return ((std::uint64_t(1) << (2 * level)) - 1) / 3;
+}
+
+template <typename T>
+void write(std::string &out, T value)
+{
+    for (std::size_t i(0); i < sizeof(T); ++i) {
+        out.push_back(char(value & 0xff));
+        value >>= 8;
+    }
+}
+
+void write(std::string &out, double value)
+{
+    std::uint64_t raw;
+    std::memcpy(&raw, &value, sizeof(raw));
+    write(out, raw);
+}
+
+void pad(std::string &out, char c)
+{
+    while (out.size() % 8) { out.push_back(c); }
+}
+
+void setBit(std::vector<std::uint8_t> &bits, std::uint64_t index)
+{
+    bits[index >> 3] |= std::uint8_t(1 << (index & 0x7));
+}
+
+/** Returns levels if they are in supported range, throws otherwise. Called
+ *  before any bitstream is allocated.
+ */
+unsigned int checkLevels(unsigned int levels)
+{
+    if (levels > 16) {
+        LOGTHROW(err2, InternalError)
+            << "Too many subtree levels (" << levels << ").";
+    }
+    return levels;
+}
+
+} // namespace
+
+Subtree::Subtree(unsigned int levels)
+    : levels_(checkLevels(levels))
+    , childSubtrees_(((std::uint64_t(1) << (2 * levels)) + 7) / 8, 0)
+{}
+
+void Subtree::tile(unsigned int level, unsigned int x, unsigned int y
+                   , bool content, const math::Extents3 &region
+                   , double geometricError)
+{
+    tiles_[levelOffset(level) + morton(x, y)]
+        = Tile{ content, region, geometricError };
+}
+
+void Subtree::childSubtree(unsigned int x, unsigned int y)
+{
+    setBit(childSubtrees_, morton(x, y));
+}
+
+void Subtree::write(std::ostream &os) const
+{
+    const auto tileCount(levelOffset(levels_));
+
+    // availability bitstreams
+    std::vector<std::uint8_t> tileBits((tileCount + 7) / 8, 0);
+    std::vector<std::uint8_t> contentBits(tileBits.size(), 0);
+    std::size_t contentCount(0);
+    for (const auto &item : tiles_) {
+        setBit(tileBits, item.first);
+        if (item.second.content) {
+            setBit(contentBits, item.first);
+            ++contentCount;
+        }
+    }
+
+    std::size_t childCount(0);
+    for (auto byte : childSubtrees_) {
+        for (; byte; byte &= byte - 1) { ++childCount; }
+    }
+
+    // binary chunk; each buffer view is 8-byte aligned
+    std::string bin;
+    std::ostringstream views;
+    int viewCount(0);
+    const auto view([&](const std::string &data) -> int
+    {
+        if (viewCount) { views << ','; }
+        views << "{\"buffer\":0,\"byteOffset\":" << bin.size()
+              << ",\"byteLength\":" << data.size() << '}';
+        bin.append(data);
+        pad(bin, '\0');
+        return viewCount++;
+    });
+
+    const auto bitstream([&](const std::vector<std::uint8_t> &bits)
+    {
+        return view(std::string(bits.begin(), bits.end()));
+    });
+
+    // metadata: one row per available tile, in bitstream order
+    std::string regions, errors;
+    for (const auto &item : tiles_) {
+        const auto &r(item.second.region);
+        for (double v : { r.ll(0), r.ll(1), r.ur(0), r.ur(1)
+                    , r.ll(2), r.ur(2) })
+        {
+            vts2tdt::write(regions, v);
+        }
+        vts2tdt::write(errors, item.second.geometricError);
+    }
+
+    // JSON chunk
+    std::ostringstream json;
+    json.precision(15);
+
+    const auto availability([&](const std::vector<std::uint8_t> &bits
+                                , std::size_t count, std::size_t total)
+    {
+        if (!count) { json << "{\"constant\":0}"; return; }
+        if (count == total) { json << "{\"constant\":1}"; return; }
+        json << "{\"bitstream\":" << bitstream(bits)
+             << ",\"availableCount\":" << count << '}';
+    });
+
+    json << "{\"tileAvailability\":";
+    availability(tileBits, tiles_.size(), tileCount);
+    json << ",\"contentAvailability\":[";
+    availability(contentBits, contentCount, tileCount);
+    json << "],\"childSubtreeAvailability\":";
+    availability(childSubtrees_, childCount
+                 , std::size_t(1) << (2 * levels_));
+
+    if (!tiles_.empty()) {
+        const auto regionsView(view(regions));
+        const auto errorsView(view(errors));
+        json << ",\"tileMetadata\":0,\"propertyTables\":[{\"class\":\"tile\""
+             << ",\"count\":" << tiles_.size()
+             << ",\"properties\":{\"boundingRegion\":{\"values\":"
+             << regionsView << "},\"geometricError\":{\"values\":"
+             << errorsView << "}}}]";
+    }
+
+    if (viewCount) {
+        json << ",\"buffers\":[{\"byteLength\":" << bin.size() << "}]"
+             << ",\"bufferViews\":[" << views.str() << ']';
+    }
+    json << '}';
+
+    auto jsonChunk(json.str());
+    pad(jsonChunk, ' ');
+
+    // header
+    std::string header("subt", 4);
+    vts2tdt::write<std::uint32_t>(header, 1);
+    vts2tdt::write<std::uint64_t>(header, jsonChunk.size());
+    vts2tdt::write<std::uint64_t>(header, bin.size());
+
+    os.write(header.data(), header.size());
+    os.write(jsonChunk.data(), jsonChunk.size());
+    os.write(bin.data(), bin.size());
+}
+
+} // namespace vts2tdt
@@ -0,0 +1,102 @@
+/**
+ * Copyright (c) 2021 Melown Technologies SE
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * *  Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * *  Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef vtsd_delivery_vts_vts2tdt_implicit_hpp_included_
+#define vtsd_delivery_vts_vts2tdt_implicit_hpp_included_
+
+#include <map>
+#include <vector>
+#include <string>
+#include <ostream>
+#include <cstdint>
+
+#include "math/geometry_core.hpp"
+
+namespace vts2tdt {
+
+/** Metadata schema of implicit tiles. Per-tile bounding region and geometric
+ *  error are stored in subtree files since VTS tile extents are not a
+ *  uniform subdivision of any single region.
+ */
+extern const char *ImplicitSchema;
+
+/** 3D Tiles 1.1 quadtree subtree (binary .subtree file) builder.
+ *
+ *  Tile coordinates are relative to subtree root, availability bitstreams
+ *  are indexed by Morton order as required by the specification.
+ */
+class Subtree {
+public:
+    /** Creates subtree spanning given number of levels.
+     */
+    Subtree(unsigned int levels);
+
+    /** Marks tile available. Tiles can be added in any order.
+     *
+     * \param level level relative to subtree root
+     * \param x column relative to subtree root at given level
+     * \param y row relative to subtree root at given level
+     * \param content tile has content
+     * \param region tile bounding region (radians, meters)
+     * \param geometricError tile geometric error
+     */
+    void tile(unsigned int level, unsigned int x, unsigned int y
+              , bool content, const math::Extents3 &region
+              , double geometricError);
+
+    /** Marks child subtree (i.e. tile at level == levels) available.
+     */
+    void childSubtree(unsigned int x, unsigned int y);
+
+    /** Returns true if no tile is available.
+     */
+    bool empty() const { return tiles_.empty(); }
+
+    /** Writes binary subtree file.
+     */
+    void write(std::ostream &os) const;
+
+private:
+    struct Tile {
+        bool content;
+        math::Extents3 region;
+        double geometricError;
+    };
+
+    const unsigned int levels_;
+
+    /** Available tiles indexed by their tile availability bit.
+     */
+    std::map<std::uint64_t, Tile> tiles_;
+
+    /** Child subtree availability bitstream.
+     */
+    std::vector<std::uint8_t> childSubtrees_;
+};
+
+} // namespace vts2tdt
+
+#endif // vtsd_delivery_vts_vts2tdt_implicit_hpp_included_
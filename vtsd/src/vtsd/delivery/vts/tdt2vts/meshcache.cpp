@@ -0,0 +1,329 @@
+/**
+ * Copyright (c) 2021 Melown Technologies SE
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * *  Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * *  Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <fstream>
+#include <iterator>
+#include <sstream>
+#include <thread>
+#include <functional>
+#include <system_error>
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <boost/filesystem.hpp>
+#include <boost/format.hpp>
+#include <boost/lexical_cast.hpp>
+#include <boost/algorithm/string/predicate.hpp>
+
+#include "dbglog/dbglog.hpp"
+
+#include "meshcache.hpp"
+
+namespace fs = boost::filesystem;
+namespace po = boost::program_options;
+namespace ba = boost::algorithm;
+namespace vts = vtslibs::vts;
+
+namespace vts2tdt {
+
+void MeshCacheOptions::configuration(po::options_description &od
+                                     , const std::string &prefix)
+{
+    od.add_options()
+        ((prefix + "memoryItems").c_str()
+         , po::value(&memoryItems)->default_value(memoryItems)->required()
+         , "Number of converted 3D Tiles meshes kept in memory per dataset. "
+         "Use 0 to disable.")
+        ((prefix + "dir").c_str()
+         , po::value(&dir)
+         , "Root directory of on-disk cache of converted 3D Tiles meshes. "
+         "On-disk cache is disabled if not set.")
+        ((prefix + "diskLimit").c_str()
+         , po::value(&diskLimit)->default_value(diskLimit)->required()
+         , "Maximum size (in bytes) of on-disk cache of converted 3D Tiles "
+         "meshes per dataset.")
+        ;
+}
+
+std::ostream& MeshCacheOptions::dump(std::ostream &os
+                                     , const std::string &prefix) const
+{
+    os << prefix << "memoryItems = " << memoryItems << "\n";
+    if (dir.empty()) {
+        os << prefix << "dir = none\n";
+    } else {
+        os << prefix << "dir = " << dir << "\n"
+           << prefix << "diskLimit = " << diskLimit << "\n";
+    }
+    return os;
+}
+
+namespace {
+
+/** Extension of cached files. Anything else in cache directory is a
+ *  temporary file.
+ */
+const std::string CachedFileExt(".gz");
+
+} // namespace
+
+MeshCache::pointer MeshCache::create(const MeshCacheOptions &options
+                                     , const fs::path &datasetPath
+                                     , unsigned int revision)
+{
+    if (!options.memoryItems && options.dir.empty()) { return {}; }
+
+    if (options.dir.empty()) {
+        return pointer(new MeshCache(options, {}));
+    }
+
+    struct ::stat st;
+    if (-1 == ::stat(datasetPath.c_str(), &st)) {
+        std::system_error e(errno, std::system_category());
+        LOG(warn2) << "Cannot stat dataset " << datasetPath
+                   << ": <" << e.code() << ", " << e.what()
+                   << ">; on-disk mesh cache disabled.";
+        return pointer(new MeshCache(options, {}));
+    }
+
+    // dataset identity
+    const auto prefix(str(boost::format("%x-%x-")
+                          % st.st_dev % st.st_ino));
+
+    // remove content of older revisions of this dataset
+    boost::system::error_code ec;
+    for (fs::directory_iterator idir(options.dir, ec), edir
+             ; !ec && (idir != edir); idir.increment(ec))
+    {
+        const auto name(idir->path().filename().string());
+        if (!ba::starts_with(name, prefix)) { continue; }
+
+        unsigned int dirRevision(0);
+        try {
+            dirRevision = boost::lexical_cast<unsigned int>
+                (name.substr(prefix.size()));
+        } catch (const boost::bad_lexical_cast&) {
+            // not ours
+            continue;
+        }
+
+        if (dirRevision < revision) {
+            boost::system::error_code rec;
+            fs::remove_all(idir->path(), rec);
+        }
+    }
+
+    // directory shared by everybody serving this revision
+    const auto dir(options.dir / str(boost::format("%s%u")
+                                      % prefix % revision));
+    fs::create_directories(dir, ec);
+    if (ec) {
+        LOG(warn2) << "Cannot create mesh cache directory " << dir
+                   << ": <" << ec.message()
+                   << ">; on-disk mesh cache disabled.";
+        return pointer(new MeshCache(options, {}));
+    }
+
+    return pointer(new MeshCache(options, dir));
+}
+
+MeshCache::MeshCache(const MeshCacheOptions &options, const fs::path &dir)
+    : memory_(options.memoryItems), dir_(dir)
+    , diskLimit_(options.diskLimit), diskUsage_(0)
+{
+    if (!dir_.empty()) { scan(); }
+}
+
+MeshCache::~MeshCache() {}
+
+void MeshCache::scan()
+{
+    boost::system::error_code ec;
+    for (fs::directory_iterator idir(dir_, ec), edir
+             ; !ec && (idir != edir); idir.increment(ec))
+    {
+        // NB: skip temporary files, they can be being written by another
+        // process
+        const auto &p(idir->path());
+        if (p.extension() != CachedFileExt) { continue; }
+
+        boost::system::error_code rec;
+
+        const auto size(fs::file_size(p, rec));
+        if (rec) { continue; }
+
+        const auto name(p.filename().string());
+        diskFiles_.emplace_back(name, size);
+        diskIndex_[name] = std::prev(diskFiles_.end());
+        diskUsage_ += size;
+    }
+
+    // make room if limit has been lowered
+    while ((diskUsage_ > diskLimit_) && !diskFiles_.empty()) {
+        const auto victim(diskFiles_.back().first);
+        forget(victim);
+    }
+
+    LOG(info2) << "Mesh cache " << dir_ << ": " << diskFiles_.size()
+               << " files, " << diskUsage_ << " bytes.";
+}
+
+bool MeshCache::touch(const std::string &name)
+{
+    std::lock_guard<std::mutex> guard(diskMutex_);
+    auto findex(diskIndex_.find(name));
+    if (findex == diskIndex_.end()) { return false; }
+    diskFiles_.splice(diskFiles_.begin(), diskFiles_, findex->second);
+    return true;
+}
+
+bool MeshCache::reserve(const std::string &name, std::size_t size)
+{
+    if (size > diskLimit_) { return false; }
+
+    std::lock_guard<std::mutex> guard(diskMutex_);
+    if (diskIndex_.count(name)) { return false; }
+
+    // evict least recently used files
+    while ((diskUsage_ + size) > diskLimit_) {
+        const auto victim(diskFiles_.back().first);
+        diskUsage_ -= diskFiles_.back().second;
+        diskIndex_.erase(victim);
+        diskFiles_.pop_back();
+
+        boost::system::error_code ec;
+        fs::remove(dir_ / victim, ec);
+    }
+
+    diskFiles_.emplace_front(name, size);
+    diskIndex_[name] = diskFiles_.begin();
+    diskUsage_ += size;
+    return true;
+}
+
+void MeshCache::forget(const std::string &name)
+{
+    {
+        std::lock_guard<std::mutex> guard(diskMutex_);
+        auto findex(diskIndex_.find(name));
+        if (findex == diskIndex_.end()) { return; }
+        diskUsage_ -= findex->second->second;
+        diskFiles_.erase(findex->second);
+        diskIndex_.erase(findex);
+    }
+
+    boost::system::error_code ec;
+    fs::remove(dir_ / name, ec);
+}
+
+std::string MeshCache::filename(const Key &key) const
+{
+    const auto &tileId(std::get<0>(key));
+    const auto &compression(std::get<2>(key));
+    return str(boost::format("%d-%d-%d.%s%d.%s%s")
+               % tileId.lod % tileId.x % tileId.y
+               % compression.compressor % compression.level
+               % std::get<1>(key) % CachedFileExt);
+}
+
+MeshCache::Mesh MeshCache::get(const vts::TileId &tileId, MeshFormat format
+                               , const CompressionConfig &compression)
+{
+    const Key key(tileId, format, compression);
+    if (auto mesh = memory_.get(key)) { return *mesh; }
+
+    if (dir_.empty()) { return {}; }
+
+    const auto name(filename(key));
+    if (!touch(name)) { return {}; }
+
+    const auto p(dir_ / name);
+    std::ifstream f(p.string(), std::ios::in | std::ios::binary);
+    if (!f) {
+        // removed behind our back
+        forget(name);
+        return {};
+    }
+
+    std::ostringstream os;
+    os << f.rdbuf();
+    if (f.bad()) { return {}; }
+
+    boost::system::error_code ec;
+    const auto lastModified(fs::last_write_time(p, ec));
+
+    Mesh mesh(std::make_shared<const std::string>(os.str())
+              , ec ? -1 : lastModified);
+
+    // promote to memory
+    memory_.put(key, mesh);
+    return mesh;
+}
+
+void MeshCache::put(const vts::TileId &tileId, MeshFormat format
+                    , const CompressionConfig &compression, const Mesh &mesh)
+{
+    const Key key(tileId, format, compression);
+    memory_.put(key, mesh);
+
+    if (dir_.empty()) { return; }
+
+    // already on disk (or being written) or too big
+    const auto name(filename(key));
+    const auto size(mesh.data->size());
+    if (!reserve(name, size)) { return; }
+
+    // write to temporary file and move in place
+    const auto p(dir_ / name);
+    const auto tmp(fs::path(p).concat(str(boost::format(".%d.%x")
+                                          % ::getpid()
+                                          % std::hash<std::thread::id>()
+                                          (std::this_thread::get_id()))));
+    {
+        std::ofstream f(tmp.string(), std::ios::out | std::ios::binary
+                        | std::ios::trunc);
+        f.write(mesh.data->data(), size);
+        if (!f) {
+            // directory removed or disk full
+            boost::system::error_code ec;
+            fs::remove(tmp, ec);
+            return forget(name);
+        }
+    }
+
+    boost::system::error_code ec;
+    if (mesh.lastModified >= 0) {
+        fs::last_write_time(tmp, mesh.lastModified, ec);
+    }
+    fs::rename(tmp, p, ec);
+    if (ec) {
+        fs::remove(tmp, ec);
+        forget(name);
+    }
+}
+
+} // namespace vts2tdt
@@ -0,0 +1,183 @@
+/**
+ * Copyright (c) 2021 Melown Technologies SE
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * *  Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * *  Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef vtsd_delivery_vts_vts2tdt_meshcache_hpp_included_
+#define vtsd_delivery_vts_vts2tdt_meshcache_hpp_included_
+
+#include <ctime>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <tuple>
+
+#include <boost/filesystem/path.hpp>
+#include <boost/program_options.hpp>
+
+#include "utility/enum-io.hpp"
+
+#include "vts-libs/vts/basetypes.hpp"
+
+#include "../../../sink.hpp"
+#include "../../../lrucache.hpp"
+#include "../../../compress.hpp"
+
+namespace vts2tdt {
+
+/** Format of converted mesh.
+ */
+UTILITY_GENERATE_ENUM(MeshFormat,
+                      ((b3dm))
+                      ((glb))
+                      ((glbEmbedded))
+                      )
+
+/** Converted mesh cache configuration.
+ */
+struct MeshCacheOptions {
+    /** Number of meshes kept in memory per dataset. Zero disables memory
+     *  tier.
+     */
+    std::size_t memoryItems;
+
+    /** Root directory of on-disk tier. Empty disables on-disk tier.
+     */
+    boost::filesystem::path dir;
+
+    /** Maximum on-disk tier size per dataset, in bytes.
+     */
+    std::size_t diskLimit;
+
+    MeshCacheOptions()
+        : memoryItems(512), diskLimit(std::size_t(1) << 30)
+    {}
+
+    void configuration(boost::program_options::options_description &od
+                       , const std::string &prefix = "");
+
+    std::ostream& dump(std::ostream &os, const std::string &prefix = "")
+        const;
+};
+
+/** Cache of converted (b3dm or GLB, gzipped) meshes of one dataset.
+ *
+ *  Two tiers: in-memory LRU and a size-capped on-disk store. On-disk store
+ *  lives in a directory named by dataset's device, inode and revision, i.e.
+ *  content is invalidated by a new revision (or a replaced dataset) and
+ *  survives restarts and is shared by all processes serving the same
+ *  revision. Directories of older revisions of the same dataset are removed
+ *  on construction; nothing else is ever removed wholesale.
+ *
+ *  On-disk tier is kept under diskLimit by evicting least recently used
+ *  files. Usage is computed from directory content on construction and then
+ *  tracked per cache instance, i.e. it is approximate when multiple processes
+ *  write into the same directory.
+ */
+class MeshCache {
+public:
+    typedef std::shared_ptr<MeshCache> pointer;
+
+    struct Mesh {
+        SharedBuffer data;
+        std::time_t lastModified;
+
+        Mesh(const SharedBuffer &data = {}, std::time_t lastModified = -1)
+            : data(data), lastModified(lastModified)
+        {}
+
+        operator bool() const { return bool(data); }
+    };
+
+    /** Creates cache for given dataset. Returns null if caching is disabled.
+     */
+    static pointer create(const MeshCacheOptions &options
+                          , const boost::filesystem::path &datasetPath
+                          , unsigned int revision);
+
+    ~MeshCache();
+
+    /** Looks up mesh in given format compressed with given compression in
+     *  memory, then on disk.
+     */
+    Mesh get(const vtslibs::vts::TileId &tileId, MeshFormat format
+             , const CompressionConfig &compression);
+
+    /** Stores mesh in both tiers. Disk write is skipped if the mesh is
+     *  already on disk or if it is larger than the whole disk tier; least
+     *  recently used files are evicted to make room for it.
+     */
+    void put(const vtslibs::vts::TileId &tileId, MeshFormat format
+             , const CompressionConfig &compression, const Mesh &mesh);
+
+private:
+    MeshCache(const MeshCacheOptions &options
+              , const boost::filesystem::path &dir);
+
+    typedef std::tuple<vtslibs::vts::TileId, MeshFormat, CompressionConfig>
+        Key;
+
+    /** Filename of given mesh inside disk tier directory.
+     */
+    std::string filename(const Key &key) const;
+
+    /** Scans disk tier directory and registers cached files.
+     */
+    void scan();
+
+    /** Marks file as most recently used. Returns false if not known.
+     */
+    bool touch(const std::string &name);
+
+    /** Reserves room for new file in disk tier, evicting least recently used
+     *  files. Returns false if file is already known or cannot fit at all.
+     */
+    bool reserve(const std::string &name, std::size_t size);
+
+    /** Forgets file (and removes it from disk).
+     */
+    void forget(const std::string &name);
+
+    LruCache<Key, Mesh> memory_;
+
+    /** Disk tier directory, empty if disabled.
+     */
+    const boost::filesystem::path dir_;
+    const std::size_t diskLimit_;
+
+    /** Disk tier bookkeeping: files (with sizes), most recently used first.
+     */
+    typedef std::list<std::pair<std::string, std::size_t>> DiskFiles;
+
+    std::mutex diskMutex_;
+    DiskFiles diskFiles_;
+    std::map<std::string, DiskFiles::iterator> diskIndex_;
+    std::size_t diskUsage_;
+};
+
+} // namespace vts2tdt
+
+#endif // vtsd_delivery_vts_vts2tdt_meshcache_hpp_included_
@@ -24,54 +24,128 @@
  * POSSIBILITY OF SUCH DAMAGE.
  */
 
-#include "3dtiles/3dtiles.hpp"
+#include <sstream>
+#include <mutex>
+#include <vector>
+
+#include <boost/optional.hpp>
 
 #include "../../driver.hpp"
+#include "../support.hpp"
 
 #include "support.hpp"
 #include "constants.hpp"
+#include "implicit.hpp"
 #include "metabuilder.hpp"
 
 namespace vts = vtslibs::vts;
 namespace vs = vtslibs::storage;
 namespace vr = vtslibs::registry;
-
-namespace tdt = threedtiles;
+namespace po = boost::program_options;
 
 namespace vts2tdt {
 
-namespace {
+void RegionCacheOptions::configuration(po::options_description &od
+                                       , const std::string &prefix)
+{
+    od.add_options()
+        ((prefix + "items").c_str()
+         , po::value(&items)->default_value(items)->required()
+         , "Number of node regions (node extents converted to 3D Tiles "
+         "regions) cached per dataset; one entry takes roughly 150 bytes. "
+         "Use 0 to disable.")
+        ;
+}
+
+std::ostream& RegionCacheOptions::dump(std::ostream &os
+                                       , const std::string &prefix) const
+{
+    os << prefix << "items = " << items << "\n";
+    return os;
+}
 
-using FT = vts::TileIndex::Flag;
+SerializedTileset::SerializedTileset(const std::string &json
+                                     , std::time_t lastModified
+                                     , const CompressionConfig &compression
+                                     , const std::string &contentType)
+    : lastModified(lastModified)
+    , contentType(contentType.empty()
+                  ? std::string(vs::contentType(vs::File::config))
+                  : contentType)
+{
+    data = std::make_shared<const std::string>(gzip(json, compression));
+    etag = makeETag(data->data(), data->size());
+}
+
+void SerializedTileset::send(Sink &sink, const Location &location
+                             , FileClass fileClass) const
+{
+    Sink::FileInfo stat(contentType, lastModified);
+    stat.setFileClass(fileClass);
+    sendGzipped(sink, location, data, stat, etag);
+}
+
+namespace {
 
-math::Extents3 regionExtents(const vts::NodeInfo &ni
+math::Extents3 regionExtents(const std::string &srs
+                             , const math::Extents2 &extents
                              , const vts::GeomExtents::ZRange &z
                              , const Convertors &convertors)
 {
-    const auto &conv(convertors(ni.srs()));
-
-    // make 3D extents from SDS tile extents and geom extents Z-range
-    auto e(math::extents3(ni.extents()));
+    // make 3D extents from SDS extents and geom extents Z-range
+    auto e(math::extents3(extents));
     e.ll(2) = z.min;
     e.ur(2) = z.max;
 
+    // convert all eight corners (point by point)
+    const auto vertices(math::vertices(e));
+    math::Points3 corners(vertices.begin(), vertices.end());
+    convertors.convert(corners, srs);
+
     math::Extents3 region(math::InvalidExtents{});
+    for (const auto &v : corners) { math::update(region, v); }
+
+    return region;
+}
+
+math::Extents3 region(const vts::MetaNode &node
+                      , const vts::NodeInfo &ni
+                      , const Convertors &convertors
+                      , RegionCache &regions)
+{
+    const auto &z(node.geomExtents.z);
+
+    return regions.get(RegionKey(ni.nodeId(), z.min, z.max), [&]()
+    {
+        return regionExtents(ni.srs(), ni.extents(), z, convertors);
+    });
+}
+
+/** Measures bounding region of real nodes in subtree rooted at ni.
+ */
+math::Extents3 measure(const Convertors &convertors, SubtreeIndex &subtrees
+                       , const vts::NodeInfo &ni
+                       , const vts::GeomExtents::ZRange &z)
+{
+    math::Extents3 e(math::InvalidExtents{});
 
-    // conver all eight corners
-    for (const auto &v : math::vertices(e)) {
-        math::update(region, conv(v));
+    // convert aggregated extents of real nodes in the subtree
+    for (const auto &item : *subtrees.get(ni)) {
+        math::update(e, regionExtents(item.first, item.second, z
+                                      , convertors));
     }
 
-    return region;
+    return e;
 }
 
-tdt::Region region(const vts::MetaNode &node
-                   , const vts::NodeInfo &ni
-                   , const Convertors &convertors)
+/** Writes bounding volume region.
+ */
+void writeRegion(std::ostream &os, const math::Extents3 &br)
 {
-    tdt::Region region;
-    region.extents = regionExtents(ni, node.geomExtents.z, convertors);
-    return region;
+    os << "{\"region\":["
+       << br.ll(0) << ',' << br.ll(1) << ','
+       << br.ur(0) << ',' << br.ur(1) << ','
+       << br.ll(2) << ',' << br.ur(2) << "]}";
 }
 
 vts::MetaTile loadMetaTile(const vts::TileId &tileId
@@ -117,76 +191,161 @@ void loadMetaTile(const vts::TileId &tileId, const vts::Delivery &delivery
     });
 }
 
+/** Collects concurrently loaded metatiles of binary-order metatile stack.
+ *  Acts as error handler for individual loads: only the first error is
+ *  reported to the wrapped error handler.
+ */
+class MetaStack : public ErrorHandler {
+public:
+    typedef std::shared_ptr<MetaStack> pointer;
+
+    MetaStack(std::size_t size, ErrorHandler::pointer errorHandler)
+        : errorHandler_(std::move(errorHandler))
+        , slots_(size), pending_(size), failed_(false)
+    {}
+
+    /** Records loaded metatile. Calls done() if this was the last pending
+     *  metatile and no load failed. Exception thrown by done() is reported to
+     *  the wrapped error handler, i.e. it is not counted as failed load.
+     */
+    template <typename Done>
+    void set(std::size_t index, AsyncMeta meta, const Done &done) {
+        {
+            std::lock_guard<std::mutex> guard(mutex_);
+            slots_[index] = std::move(meta);
+            if (--pending_ || failed_) { return; }
+        }
+
+        try {
+            done();
+        } catch (...) {
+            (*errorHandler_)();
+        }
+    }
+
+    /** Moves loaded metatiles in stack order to output. Returns newest
+     *  modification time. Call only after last metatile is set.
+     */
+    std::time_t collect(vts::MetaTile::list &metas) {
+        std::time_t lastModified(0);
+        for (auto &slot : slots_) {
+            lastModified = std::max(lastModified, slot->lastModified);
+            metas.push_back(std::move(slot->meta));
+        }
+        slots_.clear();
+        return lastModified;
+    }
+
+private:
+    virtual void handle(const std::exception_ptr &exc) {
+        {
+            std::lock_guard<std::mutex> guard(mutex_);
+            --pending_;
+            if (failed_) { return; }
+            failed_ = true;
+        }
+        (*errorHandler_)(exc);
+    }
+
+    ErrorHandler::pointer errorHandler_;
+
+    std::mutex mutex_;
+    std::vector<boost::optional<AsyncMeta>> slots_;
+    std::size_t pending_;
+    bool failed_;
+};
+
 } // namespace
 
-void MetaBuilder::load(int depth)
+std::vector<vts::TileId> MetaBuilder::metaStack(int depth) const
 {
     const auto mbo(referenceFrame_.metaBinaryOrder);
     if (depth < 0) { depth = mbo; }
 
-    // find stack of binary-order metatiles
+    // find stack of binary-order metatiles, stop at first missing one
+    std::vector<vts::TileId> stack;
     auto tid(rootId_);
-
     for (int i = 0; i <= depth; ++i, tid = vts::lowestChild(tid)) {
         const auto mid(vts::metaId(tid, mbo));
         if (!ti_.meta(mid)) { break; }
-        std::time_t lm;
-        metas_.push_back(loadMetaTile(mid, *delivery_, mbo, &lm));
-        lastModified_ = std::max(lastModified_, lm);
+        stack.push_back(mid);
     }
+    return stack;
 }
 
-void MetaBuilder::load_async(const pointer &self
-                             , const ErrorHandler::pointer &errorHandler
-                             , const CompletionHandler &cb
-                             , int depth)
-{
-    if (depth < 0) { depth = self->referenceFrame_.metaBinaryOrder; }
-
-    // find stack of binary-order metatiles
-    loadNext(self, errorHandler, cb, self->rootId_, depth);
-}
-
-void MetaBuilder::loadNext(pointer self
-                           , const ErrorHandler::pointer &errorHandler
-                           , CompletionHandler cb
-                           , const vts::TileId &tileId, int left)
+void MetaBuilder::load(const pointer &self, DeliveryCache &cache
+                       , const ErrorHandler::pointer &errorHandler
+                       , const CompletionHandler &cb
+                       , int depth)
 {
     const auto mbo(self->referenceFrame_.metaBinaryOrder);
-    const auto metaId(vts::metaId(tileId, mbo));
-    if (!self->ti_.meta(metaId)) { return cb(*self); }
-
-    // capture "delivery" because "self" is moved into lambda
-    auto &delivery(*self->delivery_);
-
-    // run asynchronously
-    loadMetaTile(metaId, delivery, mbo, errorHandler
-                 , [=, self{std::move(self)}, cb{std::move(cb)}]
-                 (AsyncMeta ameta)
-    {
-        self->lastModified_
-            = std::max(ameta.lastModified, self->lastModified_);
-        self->metas_.push_back(std::move(ameta.meta));
-
-        if (!left) { cb(*self); return; }
+    const auto ids(self->metaStack(depth));
+    if (ids.empty()) { return cb(*self); }
+
+    // request all metatiles at once, finish when the last one arrives
+    auto stack(std::make_shared<MetaStack>(ids.size(), errorHandler));
+    const auto async(self->delivery_->async());
+    for (std::size_t i(0), e(ids.size()); i != e; ++i) {
+        const AsyncMeta::callback done([=](AsyncMeta ameta)
+        {
+            stack->set(i, std::move(ameta), [&]()
+            {
+                self->lastModified_ = std::max
+                    (self->lastModified_, stack->collect(self->metas_));
+                cb(*self);
+            });
+        });
+
+        if (async) {
+            loadMetaTile(ids[i], *self->delivery_, mbo, stack, done);
+            continue;
+        }
 
-        loadNext(std::move(self), errorHandler, std::move(cb)
-                 , vts::lowestChild(tileId), left - 1);
-    });
+        // synchronous delivery: load in cache worker
+        const auto tileId(ids[i]);
+        cache.post([stack](const DeliveryCache::Expected &value)
+        {
+            try {
+                value.get();
+            } catch (...) {
+                (*stack)();
+            }
+        }, [=]()
+        {
+            std::time_t lm;
+            auto meta(loadMetaTile(tileId, *self->delivery_, mbo, &lm));
+            done(AsyncMeta(std::move(meta), lm));
+        });
+    }
 }
 
 namespace {
 
+/** Streams tileset JSON directly to the output during traversal, i.e.
+ *  without building tile tree in memory.
+ *
+ *  Tile members are written in the order they become known: bounding volume
+ *  of a non-real tile is derived from its children and therefore written as
+ *  the last member of the tile object (JSON member order is irrelevant).
+ */
 class Helper {
 public:
-    Helper(const vts::TileIndex &ti, bool optimizeBottom)
-        : ti_(ti), optimizeBottom_(optimizeBottom)
+    Helper(std::ostream &os, SubtreeIndex &subtrees, RegionCache &regions
+           , bool optimizeBottom, const std::string &meshExt)
+        : os_(os), subtrees_(subtrees), regions_(regions)
+        , optimizeBottom_(optimizeBottom), meshExt_(meshExt)
     {}
 
-    tdt::Tile::pointer
+    /** Writes tile (prefixed with prefix) and returns its bounding region.
+     *  Nothing is written for nonexistent or invalid node; geometricError is
+     *  set only for written tile.
+     */
+    boost::optional<math::Extents3>
     traverse(const Convertors &convertors, const vts::NodeInfo &ni
              , vts::MetaTile::list::const_iterator imeta
-             , const vts::MetaTile::list::const_iterator &emeta)
+             , const vts::MetaTile::list::const_iterator &emeta
+             , const char *prefix, double &geometricError
+             , bool root = false)
     {
         const vts::TileId tileId(ni.nodeId());
 
@@ -196,17 +355,17 @@ public:
         const auto node(imeta->get(tileId, std::nothrow));
 
         // ignore nonexistent node or invalid node
-        if (!node || !node->flags()) { return {}; }
+        if (!node || !node->flags()) { return boost::none; }
 
         // OK, we have tile
-        auto tile(std::make_unique<tdt::Tile>());
+        os_ << prefix << '{';
 
-        tile->geometricError = 1e6; // how can I know?
+        geometricError = 1e6; // how can I know?
 
-        tdt::Region br;
+        math::Extents3 br(math::InvalidExtents{});
 
         if (node->real()) {
-            br = region(*node, ni, convertors);
+            br = region(*node, ni, convertors, regions_);
         }
 
         // move to next metatile
@@ -228,39 +387,43 @@ public:
              * NB: we divide geometric error by 2 because we should use
              * geometric error from children
              */
-            tile->geometricError = 16.0 * node->texelSize / 2.0;
+            geometricError = 16.0 * node->texelSize / 2.0;
+        }
 
-            // real content
-            if (!link) {
-                tile->content.emplace();
-                // either inside node or leaf at the bottom
-                tile->content->uri = filename(tileId, constants::B3dmExt);
-            }
+        os_ << "\"geometricError\":" << geometricError;
+
+        if (root) {
+            // refinement is inherited by all descendants
+            os_ << ",\"refine\":\"REPLACE\"";
         }
 
         if (link) {
             // non-real node at bottom with children
-            tile->content.emplace();
-            tile->content->uri = filename(tileId, constants::JsonExt);
+            writeContent(filename(tileId, constants::JsonExt));
+        } else if (node->real()) {
+            // real content, either inside node or leaf at the bottom
+            writeContent(filename(tileId, meshExt_));
         }
 
         // process children if not at the bottom
         if (!bottom) {
+            bool any(false);
+            double childError;
             for (const auto &child : vts::children(*node, tileId)) {
-                tile->children.push_back
-                    (traverse(convertors, ni.child(child), imeta, emeta));
+                const auto creg
+                    (traverse(convertors, ni.child(child), imeta, emeta
+                              , (any ? "," : ",\"children\":[")
+                              , childError));
+                if (!creg) { continue; }
+                any = true;
 
                 if (!node->real()) {
                     // accumulate children bounding volume's in non-real
                     // tiles
-                    const auto &ctile(*tile->children.back());
-                    if (auto *creg = boost::get<tdt::Region>
-                        (&ctile.boundingVolume))
-                        {
-                            math::update(br.extents, creg->extents);
-                        }
+                    math::update(br, *creg);
                 }
             }
+            if (any) { os_ << ']'; }
         } else if (!node->real()) {
             /* non-real tile at the bottom of the tree, we need to find real
              * nodes to guess much tighter geometry than the one we currenty
@@ -271,81 +434,171 @@ public:
              */
 
             // TODO: generate resolution as well
-            const auto extents(measure(convertors, ni, node->geomExtents.z));
-
-            // use subtree extents
-            br.extents = extents;
+            br = measure(convertors, subtrees_, ni, node->geomExtents.z);
         }
 
-        if (!valid(br.extents)) {
+        if (!valid(br)) {
             // last resort: use this node's geometric extents
-            br = region(*node, ni, convertors);
+            br = region(*node, ni, convertors, regions_);
         }
 
-        // set bounding volume
-        tile->boundingVolume = br;
+        // bounding volume is known now
+        os_ << ",\"boundingVolume\":";
+        writeRegion(os_, br);
+        os_ << '}';
 
-        return tile;
+        return br;
     };
 
-    math::Extents3
-    measure(const Convertors &convertors
-            , const vts::NodeInfo &ni
-            , const vts::GeomExtents::ZRange &z)
-    {
-        // TODO: limit depth?
-
-        if (!ni.valid()) { return math::Extents3(math::InvalidExtents{}); }
-
-        const vts::TileId tileId(ni.nodeId());
+private:
+    void writeContent(const std::string &uri) {
+        // tile file names need no escaping
+        os_ << ",\"content\":{\"uri\":\"" << uri << "\"}";
+    }
 
-        const auto flags(ti_.get(tileId));
+    std::ostream &os_;
+    SubtreeIndex &subtrees_;
+    RegionCache &regions_;
+    bool optimizeBottom_;
+    const std::string &meshExt_;
+};
 
-        // real tile -> use extents
-        if (FT::isReal(flags)) {
-            return regionExtents(ni, z, convertors);
-        }
+/** Bounding region and geometric error of implicit tile. There is no
+ *  traversal to derive non-real tile's region from, therefore it is measured
+ *  from real nodes in its subtree.
+ */
+std::pair<math::Extents3, double>
+implicitTile(const vts::MetaNode &node, const vts::NodeInfo &ni
+             , const Convertors &convertors, SubtreeIndex &subtrees
+             , RegionCache &regions)
+{
+    if (node.real()) {
+        // see Helper::traverse
+        return { region(node, ni, convertors, regions)
+                 , 16.0 * node.texelSize / 2.0 };
+    }
 
-        math::Extents3 e(math::InvalidExtents{});
+    auto br(measure(convertors, subtrees, ni, node.geomExtents.z));
+    if (!valid(br)) {
+        // last resort: use this node's geometric extents
+        br = region(node, ni, convertors, regions);
+    }
+    return { br, 1e6 };
+}
 
-        // check if there are any children, i.e. subtree starting at this tile
-        // ID must be valid in next lod's tree (yes, quadtree magic)
-        if (!ti_.validSubtree(tileId.lod + 1, tileId)) { return e; }
+} // namespace
 
-        // let's traverse children
-        for (const auto &child : vts::children(tileId)) {
-            auto ce(measure(convertors, ni.child(child), z));
-            if (math::valid(ce)) {
-                math::update(e, ce);
-            }
-        }
+bool MetaBuilder::run(std::ostream &os, LocationConfig::TdtContent content)
+{
+    if (metas_.empty()) { return false; }
 
-        return e;
+    os.precision(15);
+
+    // what version to use in subtilesets? NB: GLB content needs 1.1
+    os << "{\"asset\":{\"version\":\""
+       << ((content == LocationConfig::TdtContent::glb) ? "1.1" : "1.0")
+       << "\",\"tilesetVersion\":\""
+       << delivery_->properties().revision << "\"}";
+
+    Helper helper(os, *subtrees_, *regions_, optimizeBottom_
+                  , meshExtension(content));
+    double geometricError;
+    if (!helper.traverse(ptc_->get()
+                         , vts::NodeInfo(referenceFrame_, rootId_)
+                         , metas_.begin(), metas_.end(), ",\"root\":"
+                         , geometricError, true))
+    {
+        // no root tile
+        return false;
     }
 
-private:
-    const vts::TileIndex &ti_;
-    bool optimizeBottom_;
-};
+    // copy geometric error
+    os << ",\"geometricError\":" << geometricError << '}';
 
-} // namespace
+    return true;
+}
 
-bool MetaBuilder::run(tdt::Tileset &ts)
+bool MetaBuilder::runImplicit(std::ostream &os
+                              , LocationConfig::TdtContent content)
 {
     if (metas_.empty()) { return false; }
 
-    // what version to use in subtilesets?
-    ts.asset.tilesetVersion
-        = utility::format("%s", delivery_->properties().revision);
+    const auto node(metas_.front().get(rootId_, std::nothrow));
+    if (!node || !node->flags()) { return false; }
+
+    const auto tile(implicitTile(*node, vts::NodeInfo(referenceFrame_, rootId_)
+                                 , ptc_->get(), *subtrees_, *regions_));
+    const auto lodRange
+        (ti_.tileIndex.ranges(vts::TileIndex::Flag::mesh).first);
+
+    os.precision(15);
+
+    os << "{\"asset\":{\"version\":\"1.1\",\"tilesetVersion\":\""
+       << delivery_->properties().revision << "\"}"
+       << ",\"schema\":" << ImplicitSchema
+       << ",\"geometricError\":" << tile.second
+       << ",\"root\":{\"boundingVolume\":";
+    writeRegion(os, tile.first);
+    os << ",\"geometricError\":" << tile.second
+       << ",\"refine\":\"REPLACE\""
+       << ",\"content\":{\"uri\":\"{level}-{x}-{y}."
+       << meshExtension(content) << "\"}"
+       << ",\"implicitTiling\":{\"subdivisionScheme\":\"QUADTREE\""
+       << ",\"subtreeLevels\":" << subtreeLevels(referenceFrame_)
+       << ",\"availableLevels\":" << (lodRange.max + 1)
+       << ",\"subtrees\":{\"uri\":\"{level}-{x}-{y}."
+       << constants::SubtreeExt << "\"}}}}";
+
+    return true;
+}
 
-    Helper helper(ti_.tileIndex, optimizeBottom_);
-    ts.root = helper.traverse(ptc_->get()
-                              , vts::NodeInfo(referenceFrame_, rootId_)
-                              , metas_.begin(), metas_.end());
+bool MetaBuilder::runSubtree(std::ostream &os)
+{
+    const auto levels(subtreeLevels(referenceFrame_));
+    const auto convertors(ptc_->get());
+
+    Subtree subtree(levels);
+
+    // one metatile per level
+    auto imeta(metas_.begin());
+    for (unsigned int level(0); (level < levels) && (imeta != metas_.end())
+             ; ++level, ++imeta)
+    {
+        const auto size(1u << level);
+        const auto last(level + 1 == levels);
+
+        for (unsigned int y(0); y < size; ++y) {
+            for (unsigned int x(0); x < size; ++x) {
+                const vts::TileId tileId(rootId_.lod + level
+                                         , (rootId_.x << level) + x
+                                         , (rootId_.y << level) + y);
+
+                // ignore nonexistent node or invalid node
+                const auto node(imeta->get(tileId, std::nothrow));
+                if (!node || !node->flags()) { continue; }
+
+                const vts::NodeInfo ni(referenceFrame_, tileId);
+                if (!ni.valid()) { continue; }
+
+                const auto tile(implicitTile(*node, ni, convertors
+                                             , *subtrees_, *regions_));
+                subtree.tile(level, x, y, node->real()
+                             , tile.first, tile.second);
+
+                if (!last) { continue; }
+
+                // children of bottom tiles are roots of child subtrees
+                for (const auto &child : vts::children(*node, tileId)) {
+                    subtree.childSubtree(child.x - (rootId_.x << levels)
+                                         , child.y - (rootId_.y << levels));
+                }
+            }
+        }
+    }
 
-    // copy geometric error?
-    ts.geometricError = ts.root->geometricError;
+    if (subtree.empty()) { return false; }
 
+    subtree.write(os);
     return true;
 }
 
@@ -27,29 +27,111 @@
 #ifndef vtsd_delivery_vts_vts2tdt_metabuilder_hpp_included_
 #define vtsd_delivery_vts_vts2tdt_metabuilder_hpp_included_
 
-#include "utility/gzipper.hpp"
+#include <tuple>
+#include <ostream>
+
+#include <boost/program_options.hpp>
 
 #include "vts-libs/storage/support.hpp"
 #include "vts-libs/vts/tileset/driver.hpp"
 #include "vts-libs/vts/tileset/delivery.hpp"
 
-#include "3dtiles/3dtiles.hpp"
-
 #include "../../driver.hpp"
+#include "../../cache.hpp"
+#include "../../../lrucache.hpp"
+#include "../../../compress.hpp"
 #include "convertors.hpp"
+#include "subtree.hpp"
 
 namespace vts2tdt {
 
-template <typename T>
-vtslibs::storage::IStream::pointer serialize(const threedtiles::Tileset &ts
-                                             , const std::string &path
-                                             , T &&type
-                                             , std::time_t lastModified)
+/** Serialized (gzipped) tileset JSON or subtree file.
+ */
+struct SerializedTileset {
+    SharedBuffer data;
+    std::time_t lastModified;
+    std::string etag;
+    std::string contentType;
+
+    SerializedTileset() : lastModified(-1) {}
+
+    /** Serializes tileset JSON (or any content when contentType is given).
+     */
+    SerializedTileset(const std::string &json
+                      , std::time_t lastModified
+                      , const CompressionConfig &compression
+                      , const std::string &contentType = {});
+
+    void send(Sink &sink, const Location &location, FileClass fileClass)
+        const;
+};
+
+/** Kind of cached tileset file.
+ */
+enum class TilesetKind {
+    meta, tileset, implicitTileset, subtree
+};
+
+/** Tileset cache key: (kind, root tile ID, mesh content format,
+ *  compression).
+ */
+typedef std::tuple<TilesetKind, vtslibs::vts::TileId
+                   , LocationConfig::TdtContent, CompressionConfig>
+    TilesetCacheKey;
+
+/** Per-driver cache of serialized tileset.json and metatile JSONs. Driver is
+ *  reopened when dataset changes, therefore cached content is always valid
+ *  for the current revision.
+ */
+class TilesetCache : public LruCache<TilesetCacheKey, SerializedTileset> {
+public:
+    typedef std::shared_ptr<TilesetCache> pointer;
+
+    TilesetCache(std::size_t capacity = (1 << 12))
+        : LruCache<TilesetCacheKey, SerializedTileset>(capacity)
+    {}
+};
+
+/** Region cache key: (tile ID, z-min, z-max).
+ */
+typedef std::tuple<vtslibs::vts::TileId, double, double> RegionKey;
+
+/** Node region cache configuration.
+ */
+struct RegionCacheOptions {
+    /** Number of node regions cached per dataset. One entry takes roughly
+     *  150 bytes (key, extents and LRU bookkeeping). Zero disables caching.
+     */
+    std::size_t items;
+
+    RegionCacheOptions() : items(1 << 16) {}
+
+    void configuration(boost::program_options::options_description &od
+                       , const std::string &prefix = "");
+
+    std::ostream& dump(std::ostream &os, const std::string &prefix = "")
+        const;
+};
+
+/** Per-driver cache of node regions (i.e. node extents converted to 3D Tiles
+ *  region).
+ */
+class RegionCache : public LruCache<RegionKey, math::Extents3> {
+public:
+    typedef std::shared_ptr<RegionCache> pointer;
+
+    RegionCache(const RegionCacheOptions &options = RegionCacheOptions())
+        : LruCache<RegionKey, math::Extents3>(options.items)
+    {}
+};
+
+/** Number of levels in one implicit tiling subtree. Subtree spans one
+ *  binary-order metatile stack, i.e. one metatile per level.
+ */
+inline unsigned int
+subtreeLevels(const vtslibs::registry::ReferenceFrame &referenceFrame)
 {
-    auto is(std::make_shared<vs::StringIStream>(type, path, lastModified));
-    threedtiles::write(utility::Gzipper(is->sink()), ts);
-    is->updateSize();
-    return is;
+    return referenceFrame.metaBinaryOrder + 1;
 }
 
 class MetaBuilder {
@@ -60,55 +142,62 @@ public:
     MetaBuilder(const vtslibs::vts::Delivery::pointer &delivery
                 , const vtslibs::registry::ReferenceFrame &referenceFrame
                 , PerThreadConvertors::pointer ptc
+                , SubtreeIndex::pointer subtrees
+                , RegionCache::pointer regions
                 , const vtslibs::vts::TileId &rootId
                 , bool optimizeBottom = true)
         : delivery_(delivery)
         , referenceFrame_(referenceFrame)
         , ptc_(std::move(ptc))
+        , subtrees_(std::move(subtrees))
+        , regions_(std::move(regions))
         , rootId_(rootId)
         , ti_(delivery->index())
         , lastModified_()
         , optimizeBottom_(optimizeBottom)
     {}
 
-    void load(int depth = -1);
-
-    static void load_async(const pointer &self
-                           , const ErrorHandler::pointer &errorHandler
-                           , const CompletionHandler &cb
-                           , int depth = -1);
-
-    bool run(threedtiles::Tileset &ts);
-
-    template <typename FileType>
-    void send(Sink &sink, const Location &location
-              , const threedtiles::Tileset &ts
-              , FileType fileType, FileClass fileClass
-              , std::time_t lastModified)
-    {
-        return sink.content
-            (serialize(ts, location.path, fileType, lastModified)
-             , fileClass, true);
-    }
-
-    void send(Sink &sink, const Location &location
-              , const threedtiles::Tileset &ts)
-    {
-        return send(sink, location, ts, vs::TileFile::meta, FileClass::data
-                    , lastModified_);
-    }
+    /** Loads metatile stack. All metatiles are requested at once, cb is
+     *  called when the last one arrives. Only the first failure is reported
+     *  to errorHandler; so is any exception thrown by cb.
+     *
+     *  Metatiles of asynchronous deliveries are requested via delivery's
+     *  asynchronous interface; loads from synchronous ones are posted to
+     *  delivery cache's worker pool.
+     */
+    static void load(const pointer &self, DeliveryCache &cache
+                     , const ErrorHandler::pointer &errorHandler
+                     , const CompletionHandler &cb
+                     , int depth = -1);
+
+    /** Writes tileset JSON to os. Tiles are streamed during traversal.
+     *  Returns false if there is nothing to write (output is then undefined).
+     *  Mesh content is referenced in given format.
+     */
+    bool run(std::ostream &os, LocationConfig::TdtContent content);
+
+    /** Writes 3D Tiles 1.1 implicit tileset JSON to os. Only root metatile
+     *  is needed (i.e. load(0)). Returns false if there is no root tile.
+     */
+    bool runImplicit(std::ostream &os, LocationConfig::TdtContent content);
+
+    /** Writes binary subtree file rooted at rootId to os. Needs the whole
+     *  metatile stack (i.e. load()). Returns false if subtree is empty.
+     */
+    bool runSubtree(std::ostream &os);
 
     vtslibs::vts::Delivery& delivery() const { return *delivery_; }
 
 private:
-    static void loadNext(pointer self
-                         , const ErrorHandler::pointer &errorHandler
-                         , CompletionHandler cb
-                         , const vtslibs::vts::TileId &tileId, int left);
+    /** Returns IDs of existing metatiles in binary-order stack under root.
+     */
+    std::vector<vtslibs::vts::TileId> metaStack(int depth) const;
 
     vtslibs::vts::Delivery::pointer delivery_;
     const vtslibs::registry::ReferenceFrame &referenceFrame_;
     const PerThreadConvertors::pointer ptc_;
+    const SubtreeIndex::pointer subtrees_;
+    const RegionCache::pointer regions_;
     const vtslibs::vts::TileId rootId_;
 
     const vtslibs::vts::tileset::Index &ti_;
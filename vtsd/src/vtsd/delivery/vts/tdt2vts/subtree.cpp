@@ -0,0 +1,97 @@
+/**
+ * Copyright (c) 2021 Melown Technologies SE
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * *  Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * *  Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "subtree.hpp"
+
+namespace vts = vtslibs::vts;
+
+namespace vts2tdt {
+
+namespace {
+
+using FT = vts::TileIndex::Flag;
+
+const auto emptySubtree(std::make_shared<const SubtreeExtents>());
+
+} // namespace
+
+std::shared_ptr<const SubtreeExtents>
+SubtreeIndex::get(const vts::NodeInfo &ni)
+{
+    auto budget(walkLimit_);
+    return get(ni, budget).first;
+}
+
+SubtreeIndex::Result SubtreeIndex::get(const vts::NodeInfo &ni
+                                       , std::size_t &budget)
+{
+    if (!ni.valid()) { return Result(emptySubtree, true); }
+
+    const vts::TileId tileId(ni.nodeId());
+
+    const auto own([&]()
+    {
+        return std::make_shared<const SubtreeExtents>
+            (SubtreeExtents{ { ni.srs(), ni.extents() } });
+    });
+
+    // real tile -> use its extents, no need to cache
+    if (FT::isReal(ti_.get(tileId))) { return Result(own(), true); }
+
+    // check if there are any children, i.e. subtree starting at this tile
+    // ID must be valid in next lod's tree (yes, quadtree magic)
+    if (!ti_.validSubtree(tileId.lod + 1, tileId)) {
+        return Result(emptySubtree, true);
+    }
+
+    if (auto cached = cache_.get(tileId)) { return Result(*cached, true); }
+
+    // out of budget: node's own extents cover whole subtree
+    if (!budget) { return Result(own(), false); }
+    --budget;
+
+    // aggregate children
+    auto extents(std::make_shared<SubtreeExtents>());
+    bool exact(true);
+    for (const auto &child : vts::children(tileId)) {
+        const auto res(get(ni.child(child), budget));
+        exact = exact && res.second;
+        for (const auto &item : *res.first) {
+            auto fextents(extents->find(item.first));
+            if (fextents == extents->end()) {
+                extents->insert(item);
+            } else {
+                math::update(fextents->second, item.second);
+            }
+        }
+    }
+
+    std::shared_ptr<const SubtreeExtents> result(std::move(extents));
+    if (exact) { cache_.put(tileId, result); }
+    return Result(result, exact);
+}
+
+} // namespace vts2tdt
@@ -0,0 +1,106 @@
+/**
+ * Copyright (c) 2021 Melown Technologies SE
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * *  Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * *  Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef vtsd_delivery_vts_vts2tdt_subtree_hpp_included_
+#define vtsd_delivery_vts_vts2tdt_subtree_hpp_included_
+
+#include <map>
+#include <memory>
+#include <string>
+
+#include "math/geometry_core.hpp"
+
+#include "vts-libs/vts/tileindex.hpp"
+#include "vts-libs/vts/nodeinfo.hpp"
+
+#include "../../../lrucache.hpp"
+
+namespace vts2tdt {
+
+/** Aggregated SDS extents of the topmost real nodes of a subtree, per SDS
+ *  SRS.
+ */
+typedef std::map<std::string, math::Extents2> SubtreeExtents;
+
+/** Lazily built, memoized index of subtree extents.
+ *
+ *  Subtree extents are aggregated bottom-up from children's subtree extents
+ *  and memoized for every inner (non-real) node.
+ *
+ *  Work done by one get() call is bounded: at most walkLimit inner nodes not
+ *  found in the cache are visited. When the limit is reached, remaining
+ *  unvisited subtrees are represented by their roots' own (full) extents,
+ *  i.e. the result is a conservative superset. Such partial results are not
+ *  memoized; subsequent calls continue where the previous ones stopped (exact
+ *  results of visited subtrees are memoized) and converge to exact extents.
+ *
+ *  Memory: every memoized entry holds one extents per SDS SRS in its subtree
+ *  (typically one), i.e. roughly 100 bytes per entry. Datasets with more
+ *  inner nodes than capacity keep evicting entries; thanks to walkLimit this
+ *  costs at most walkLimit node visits per call and looser bounding volumes,
+ *  never an unbounded walk.
+ */
+class SubtreeIndex {
+public:
+    typedef std::shared_ptr<SubtreeIndex> pointer;
+
+    /** Tile index must outlive this object.
+     *
+     * \param ti tile index
+     * \param capacity maximum number of memoized inner nodes
+     * \param walkLimit maximum number of inner nodes visited by one call
+     */
+    SubtreeIndex(const vtslibs::vts::TileIndex &ti
+                 , std::size_t capacity = (1 << 16)
+                 , std::size_t walkLimit = (1 << 12))
+        : ti_(ti), cache_(capacity), walkLimit_(walkLimit)
+    {}
+
+    /** Returns aggregated extents of the topmost real nodes in subtree
+     *  rooted at given node (node itself included). Result can be
+     *  conservative (see class documentation).
+     */
+    std::shared_ptr<const SubtreeExtents>
+    get(const vtslibs::vts::NodeInfo &ni);
+
+private:
+    /** Extents and flag whether they are exact.
+     */
+    typedef std::pair<std::shared_ptr<const SubtreeExtents>, bool> Result;
+
+    Result get(const vtslibs::vts::NodeInfo &ni, std::size_t &budget);
+
+    const vtslibs::vts::TileIndex &ti_;
+
+    LruCache<vtslibs::vts::TileId, std::shared_ptr<const SubtreeExtents>>
+    cache_;
+
+    const std::size_t walkLimit_;
+};
+
+} // namespace vts2tdt
+
+#endif // vtsd_delivery_vts_vts2tdt_subtree_hpp_included_
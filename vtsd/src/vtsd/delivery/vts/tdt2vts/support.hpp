@@ -30,6 +30,10 @@
 #include "vts-libs/storage/support.hpp"
 #include "vts-libs/vts/basetypes.hpp"
 
+#include "../../../config.hpp"
+
+#include "constants.hpp"
+
 namespace vts2tdt {
 
 /** Compiled-in support files (browser etc).
@@ -46,6 +50,10 @@ std::string filename(const vtslibs::vts::TileId &tileId
                      , const std::string &ext
                      , const boost::optional<int> &sub = boost::none);
 
+/** Extension of mesh tile files in given content format.
+ */
+const std::string& meshExtension(LocationConfig::TdtContent content);
+
 // inlines
 
 inline std::string filename(const vtslibs::vts::TileId &tileId
@@ -59,6 +67,12 @@ inline std::string filename(const vtslibs::vts::TileId &tileId
     return os.str();
 }
 
+inline const std::string& meshExtension(LocationConfig::TdtContent content)
+{
+    return ((content == LocationConfig::TdtContent::glb)
+            ? constants::GlbExt : constants::B3dmExt);
+}
+
 } // namespace vts2tdt
 
 #endif // vtsd_delivery_vts_vts2tdt_support_hpp_included_
@@ -38,7 +38,9 @@
 /** If adding into this enum leave unknown the last one!
  *  Make no holes, i.e. we can use values directly as indices to an array
  */
-enum class FileClass { config, support, registry, data, ephemeral, unknown };
+enum class FileClass {
+    config, support, registry, data, ephemeral, negative, unknown
+};
 
 UTILITY_GENERATE_ENUM_IO(FileClass,
                          ((config))
@@ -46,6 +48,7 @@ UTILITY_GENERATE_ENUM_IO(FileClass,
                          ((registry))
                          ((data))
                          ((ephemeral))
+                         ((negative))
                          ((unknown))
                          )
 
@@ -0,0 +1,150 @@
+/**
+ * Copyright (c) 2021 Melown Technologies SE
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * *  Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * *  Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef vtsd_lrucache_hpp_included_
+#define vtsd_lrucache_hpp_included_
+
+#include <functional>
+#include <list>
+#include <map>
+#include <mutex>
+#include <utility>
+
+#include <boost/noncopyable.hpp>
+#include <boost/optional.hpp>
+
+/** Simple thread-safe bounded cache with least-recently-used eviction.
+ *
+ *  Values are returned by copy; store (shared) pointers for anything
+ *  expensive to copy.
+ */
+template <typename Key, typename Value, typename Compare = std::less<Key>>
+class LruCache : boost::noncopyable {
+public:
+    /** Creates cache holding at most capacity items. Zero capacity disables
+     *  caching.
+     */
+    LruCache(std::size_t capacity) : capacity_(capacity) {}
+
+    /** Returns cached value and marks it as most recently used.
+     */
+    boost::optional<Value> get(const Key &key);
+
+    /** Inserts (or replaces) value; evicts least recently used item when
+     *  full.
+     */
+    void put(const Key &key, const Value &value);
+
+    /** Returns cached value or computes it by calling factory() and caches
+     *  the result. Factory is called outside lock, i.e. it can be called
+     *  multiple times for the same key concurrently.
+     */
+    template <typename Factory>
+    Value get(const Key &key, Factory factory);
+
+    std::size_t size() const;
+    std::size_t capacity() const { return capacity_; }
+
+    void clear();
+
+private:
+    typedef std::list<std::pair<Key, Value>> List;
+    typedef std::map<Key, typename List::iterator, Compare> Index;
+
+    const std::size_t capacity_;
+
+    mutable std::mutex mutex_;
+
+    /** Items, most recently used first.
+     */
+    List list_;
+    Index index_;
+};
+
+// inlines
+
+template <typename Key, typename Value, typename Compare>
+boost::optional<Value>
+LruCache<Key, Value, Compare>::get(const Key &key)
+{
+    std::lock_guard<std::mutex> guard(mutex_);
+    auto findex(index_.find(key));
+    if (findex == index_.end()) { return boost::none; }
+
+    // move to front
+    list_.splice(list_.begin(), list_, findex->second);
+    return findex->second->second;
+}
+
+template <typename Key, typename Value, typename Compare>
+void LruCache<Key, Value, Compare>::put(const Key &key, const Value &value)
+{
+    if (!capacity_) { return; }
+
+    std::lock_guard<std::mutex> guard(mutex_);
+    auto findex(index_.find(key));
+    if (findex != index_.end()) {
+        findex->second->second = value;
+        list_.splice(list_.begin(), list_, findex->second);
+        return;
+    }
+
+    list_.emplace_front(key, value);
+    index_.insert(typename Index::value_type(key, list_.begin()));
+
+    while (list_.size() > capacity_) {
+        index_.erase(list_.back().first);
+        list_.pop_back();
+    }
+}
+
+template <typename Key, typename Value, typename Compare>
+template <typename Factory>
+Value LruCache<Key, Value, Compare>::get(const Key &key, Factory factory)
+{
+    if (auto value = get(key)) { return *value; }
+
+    Value value(factory());
+    put(key, value);
+    return value;
+}
+
+template <typename Key, typename Value, typename Compare>
+std::size_t LruCache<Key, Value, Compare>::size() const
+{
+    std::lock_guard<std::mutex> guard(mutex_);
+    return list_.size();
+}
+
+template <typename Key, typename Value, typename Compare>
+void LruCache<Key, Value, Compare>::clear()
+{
+    std::lock_guard<std::mutex> guard(mutex_);
+    index_.clear();
+    list_.clear();
+}
+
+#endif // vtsd_lrucache_hpp_included_
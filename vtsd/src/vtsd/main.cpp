@@ -28,12 +28,16 @@
 #include <utility>
 #include <functional>
 #include <map>
+#include <vector>
 
 #include <boost/optional.hpp>
 #include <boost/utility/in_place_factory.hpp>
 #include <boost/filesystem.hpp>
 #include <boost/algorithm/string/predicate.hpp>
 #include <boost/algorithm/string/trim.hpp>
+#include <boost/algorithm/string/split.hpp>
+#include <boost/algorithm/string/classification.hpp>
+#include <boost/algorithm/string/erase.hpp>
 #include <boost/thread.hpp>
 
 #include "utility/streams.hpp"
@@ -80,6 +84,7 @@ LocationConfig defaultConfig()
     fcs.setMaxAge(FileClass::support, 3600);
     fcs.setMaxAge(FileClass::registry, 3600);
     fcs.setMaxAge(FileClass::data, 604800);
+    fcs.setMaxAge(FileClass::negative, 3600);
 
     return dc;
 }
@@ -122,6 +127,14 @@ private:
 
     // Daemon
     virtual DeliveryCache::OpenDriver openDriver();
+
+    /** Converted 3D Tiles mesh cache configuration.
+     */
+    vts2tdt::MeshCacheOptions meshCacheOptions_;
+
+    /** Node region cache configuration.
+     */
+    vts2tdt::RegionCacheOptions regionCacheOptions_;
 };
 
 void Vtsd::configuration(po::options_description &cmdline
@@ -129,6 +142,8 @@ void Vtsd::configuration(po::options_description &cmdline
                          , po::positional_options_description &pd)
 {
     vr::registryConfiguration(config, vr::defaultPath());
+    meshCacheOptions_.configuration(config, "tdt.meshCache.");
+    regionCacheOptions_.configuration(config, "tdt.regionCache.");
 
     return Daemon::configurationImpl(cmdline, config, pd);
 }
@@ -144,6 +159,11 @@ void Vtsd::configure(const po::variables_map &vars)
 {
     vr::registryConfigure(vars);
 
+    LOG(info3, log_) << "Config:\n"
+                     << utility::dump(meshCacheOptions_, "\ttdt.meshCache.")
+                     << utility::dump(regionCacheOptions_
+                                      , "\ttdt.regionCache.");
+
     return Daemon::configureImpl(vars);
 }
 
@@ -179,7 +199,8 @@ DeliveryCache::OpenDriver Vtsd::openDriver()
              // try VTS
              try {
                  return openVts(path, openOptions, cache, callback
-                                , proxiesConfigured());
+                                , proxiesConfigured(), meshCacheOptions_
+                                , regionCacheOptions_);
              } catch (const vs::NoSuchTileSet&) {}
 
              // finally try VTS0
@@ -207,6 +228,36 @@ getProxy(const LocationConfig &location, const http::Request &request)
     return boost::none;
 }
 
+/** Checks whether client accepts gzip content encoding.
+ */
+bool acceptsGzip(const http::Request &request)
+{
+    const auto *header(request.getHeader("Accept-Encoding"));
+    if (!header) { return false; }
+
+    std::vector<std::string> codings;
+    ba::split(codings, *header, ba::is_any_of(","));
+    for (const auto &item : codings) {
+        std::vector<std::string> parts;
+        ba::split(parts, item, ba::is_any_of(";"));
+        const auto coding(ba::trim_copy(parts.front()));
+        if ((coding != "gzip") && (coding != "x-gzip") && (coding != "*")) {
+            continue;
+        }
+
+        // explicitly refused?
+        bool refused(false);
+        for (std::size_t i(1); i < parts.size(); ++i) {
+            const auto param(ba::erase_all_copy(parts[i], " "));
+            if (ba::starts_with(param, "q=")) {
+                refused = (std::atof(param.c_str() + 2) <= 0.0);
+            }
+        }
+        if (!refused) { return true; }
+    }
+    return false;
+}
+
 namespace {
 
 class CacheErrorHandler
@@ -359,7 +410,8 @@ void Vtsd::handleDataset(DeliveryCache &deliveryCache
             driver->handle
                 (sink
                  , Location(filePath.filename().string(), request.query
-                            , getProxy(location, request))
+                            , getProxy(location, request)
+                            , acceptsGzip(request))
                  , location
                  , errorHandler
                  );
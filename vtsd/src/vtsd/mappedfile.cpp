@@ -0,0 +1,147 @@
+/**
+ * Copyright (c) 2021 Melown Technologies SE
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * *  Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * *  Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <cerrno>
+#include <cstring>
+#include <map>
+#include <mutex>
+#include <system_error>
+#include <vector>
+
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "dbglog/dbglog.hpp"
+
+#include "mappedfile.hpp"
+
+namespace {
+
+/** All live mappings.
+ */
+struct Registry {
+    std::mutex mutex;
+    std::map<MappedFile::Key, std::weak_ptr<const MappedFile>> files;
+};
+
+Registry& registry()
+{
+    static Registry registry;
+    return registry;
+}
+
+const std::size_t pageSize(::sysconf(_SC_PAGESIZE));
+
+} // namespace
+
+MappedFile::~MappedFile()
+{
+    {
+        // forget expired entry (unless it has been already replaced)
+        auto &r(registry());
+        std::lock_guard<std::mutex> guard(r.mutex);
+        auto ffiles(r.files.find(key_));
+        if ((ffiles != r.files.end()) && ffiles->second.expired()) {
+            r.files.erase(ffiles);
+        }
+    }
+
+    ::munmap(addr_, size_);
+}
+
+MappedFile::pointer MappedFile::map(int fd)
+{
+    struct ::stat st;
+    if (-1 == ::fstat(fd, &st)) {
+        std::system_error e(errno, std::system_category());
+        LOG(warn2) << "Cannot stat file descriptor " << fd
+                   << ": <" << e.code() << ", " << e.what() << ">.";
+        return {};
+    }
+
+    // only non-empty regular files can be mapped
+    if (!S_ISREG(st.st_mode) || !st.st_size) { return {}; }
+
+    const Key key{ st.st_dev, st.st_ino, st.st_size
+            , st.st_mtim.tv_sec, st.st_mtim.tv_nsec };
+
+    auto &r(registry());
+    std::lock_guard<std::mutex> guard(r.mutex);
+
+    auto &entry(r.files[key]);
+    if (auto existing = entry.lock()) { return existing; }
+
+    auto addr(::mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0));
+    if (addr == MAP_FAILED) {
+        std::system_error e(errno, std::system_category());
+        LOG(warn2) << "Cannot mmap file descriptor " << fd
+                   << ": <" << e.code() << ", " << e.what() << ">.";
+        r.files.erase(key);
+        return {};
+    }
+
+    pointer mf(new MappedFile(addr, st.st_size, key));
+    entry = mf;
+    return mf;
+}
+
+void MappedFile::advise(std::size_t offset, std::size_t size, int advice)
+    const
+{
+    if (offset >= size_) { return; }
+    if (size > (size_ - offset)) { size = size_ - offset; }
+
+    // madvise needs page-aligned start
+    const auto start(offset - (offset % pageSize));
+    size += (offset - start);
+
+    ::madvise(static_cast<char*>(addr_) + start, size, advice);
+}
+
+bool MappedFile::resident(std::size_t offset, std::size_t size) const
+{
+    if (offset >= size_) { return true; }
+    if (size > (size_ - offset)) { size = size_ - offset; }
+    if (!size) { return true; }
+
+    // mincore needs page-aligned start
+    const auto start(offset - (offset % pageSize));
+    size += (offset - start);
+
+    std::vector<unsigned char> pages((size + pageSize - 1) / pageSize);
+    if (-1 == ::mincore(static_cast<char*>(addr_) + start, size
+                        , pages.data()))
+    {
+        // cannot tell, consider cold
+        return false;
+    }
+
+    for (const auto page : pages) {
+        if (!(page & 1)) { return false; }
+    }
+    return true;
+}
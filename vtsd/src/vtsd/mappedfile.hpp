@@ -0,0 +1,100 @@
+/**
+ * Copyright (c) 2021 Melown Technologies SE
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * *  Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * *  Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef vtsd_mappedfile_hpp_included_
+#define vtsd_mappedfile_hpp_included_
+
+#include <ctime>
+#include <memory>
+#include <tuple>
+
+#include <sys/types.h>
+
+#include <boost/noncopyable.hpp>
+
+/** Read-only memory mapping of whole file.
+ *
+ *  Mappings are shared: all concurrent users of the same file (identified by
+ *  device, inode, size and modification time) get the same mapping. Mapping
+ *  is unmapped when last user releases it.
+ *
+ *  NB: file must not be truncated while mapped (SIGBUS). Datasets are expected
+ *  to be replaced (i.e. new inode) rather than rewritten in place.
+ */
+class MappedFile : boost::noncopyable {
+public:
+    typedef std::shared_ptr<const MappedFile> pointer;
+
+    /** File identity.
+     */
+    struct Key {
+        ::dev_t dev;
+        ::ino_t ino;
+        ::off_t size;
+        std::time_t mtime;
+        long mtimeNsec;
+
+        bool operator<(const Key &o) const {
+            return (std::tie(dev, ino, size, mtime, mtimeNsec)
+                    < std::tie(o.dev, o.ino, o.size, o.mtime, o.mtimeNsec));
+        }
+    };
+
+    ~MappedFile();
+
+    /** Maps file open as file descriptor fd. Existing mapping of the same
+     *  file is reused.
+     *
+     *  Returns null pointer if file cannot be mapped (empty file, mmap
+     *  failure, etc.); caller is expected to fall back to regular reads.
+     *
+     *  File descriptor is not needed after this call, i.e. it can be closed.
+     */
+    static pointer map(int fd);
+
+    const char* data() const { return static_cast<const char*>(addr_); }
+    std::size_t size() const { return size_; }
+
+    /** Calls madvise(2) on page-aligned span covering [offset, offset + size).
+     */
+    void advise(std::size_t offset, std::size_t size, int advice) const;
+
+    /** Checks via mincore(2) whether all pages of span [offset, offset + size)
+     *  are resident in page cache, i.e. whether reading them cannot block.
+     */
+    bool resident(std::size_t offset, std::size_t size) const;
+
+private:
+    MappedFile(void *addr, std::size_t size, const Key &key)
+        : addr_(addr), size_(size), key_(key)
+    {}
+
+    void *addr_;
+    std::size_t size_;
+    Key key_;
+};
+
+#endif // vtsd_mappedfile_hpp_included_
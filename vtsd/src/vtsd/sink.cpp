@@ -24,23 +24,104 @@
  * POSSIBILITY OF SUCH DAMAGE.
  */
 
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <mutex>
+#include <vector>
+#include <system_error>
+
 #include <boost/lexical_cast.hpp>
 #include <boost/format.hpp>
 #include <boost/filesystem.hpp>
+#include <boost/optional.hpp>
 
 #include <opencv2/highgui/highgui.hpp>
 
+#include <sys/mman.h>
+
 #include "dbglog/dbglog.hpp"
 
 #include "http/error.hpp"
 
 #include "sink.hpp"
 #include "error.hpp"
+#include "mappedfile.hpp"
 
 namespace fs = boost::filesystem;
 
 namespace {
 
+namespace constants {
+    /** Largest window read asynchronously into memory. Larger content is
+     *  streamed.
+     */
+    const std::size_t AsyncReadLimit(1 << 22);
+
+    /** Windows up to this size are always served from memory mapping: a few
+     *  page faults are cheaper than a round trip through the io_uring
+     *  completion path.
+     */
+    const std::size_t MappedSmallLimit(1 << 16);
+
+    /** Maximum number of idle buffers kept in buffer pool.
+     */
+    const std::size_t BufferPoolSize(256);
+}
+
+/** Pool of read buffers. Buffers are handed out as SharedBuffer that returns
+ *  itself back to the pool when released.
+ */
+class BufferPool {
+public:
+    typedef std::unique_ptr<std::string> Buffer;
+
+    /** Gets empty buffer with at least given capacity.
+     */
+    Buffer get(std::size_t capacity) {
+        Buffer buffer;
+        {
+            std::lock_guard<std::mutex> guard(mutex_);
+            if (!free_.empty()) {
+                buffer = std::move(free_.back());
+                free_.pop_back();
+            }
+        }
+
+        if (!buffer) { buffer.reset(new std::string()); }
+        buffer->reserve(capacity);
+        return buffer;
+    }
+
+    /** Converts buffer to shared buffer returned to this pool on release.
+     */
+    SharedBuffer share(Buffer buffer) {
+        return SharedBuffer(buffer.release(), [this](const std::string *b)
+        {
+            put(Buffer(const_cast<std::string*>(b)));
+        });
+    }
+
+    static BufferPool& instance() {
+        // NB: never destroyed, buffers can be released by HTTP threads
+        // during shutdown
+        static auto *pool(new BufferPool());
+        return *pool;
+    }
+
+private:
+    void put(Buffer buffer) {
+        buffer->clear();
+        std::lock_guard<std::mutex> guard(mutex_);
+        if (free_.size() < constants::BufferPoolSize) {
+            free_.push_back(std::move(buffer));
+        }
+    }
+
+    std::mutex mutex_;
+    std::vector<Buffer> free_;
+};
+
 http::SinkBase::CacheControl
 cacheControl(FileClass fileClass, const FileClassSettings *fileClassSettings)
 {
@@ -179,6 +260,136 @@ private:
     std::size_t end_;
 };
 
+/** Serves window of memory-mapped file. Stream is closed as soon as the file
+ *  is mapped, data are served directly from page cache.
+ */
+class MappedDataSource : public http::ServerSink::DataSource {
+public:
+    MappedDataSource(const MappedFile::pointer &file
+                     , const vs::IStream::pointer &stream
+                     , FileClass fileClass
+                     , const FileClassSettings *fileClassSettings
+                     , std::size_t offset, std::size_t size
+                     , bool gzipped)
+        : file_(file), stat_(stream->stat()), name_(stream->name())
+        , fs_(Sink::FileInfo(stat_.contentType, stat_.lastModified
+                             , cacheControl(fileClass, fileClassSettings)))
+        , offset_(offset), end_(offset + size)
+    {
+        // sanity check
+        if (end_ > file_->size()) { end_ = file_->size(); }
+        if (offset_ > end_) { offset_ = end_; }
+
+        // update size
+        stat_.size = (end_ - offset_);
+
+        // tell kernel what we are going to do
+        file_->advise(offset_, stat_.size, MADV_WILLNEED);
+        file_->advise(offset_, stat_.size, MADV_SEQUENTIAL);
+
+        // file is mapped, we do not need the stream anymore
+        stream->close();
+
+        if (gzipped) {
+            headers_.emplace_back("Content-Encoding", "gzip");
+        }
+    }
+
+    virtual http::SinkBase::FileInfo stat() const { return fs_; }
+
+    virtual std::size_t read(char *buf, std::size_t size, std::size_t off) {
+        // fix-ups
+        auto offset(off + offset_);
+        if (offset > end_) { return 0; }
+        auto left(end_ - offset);
+        if (size > left) { size = left; }
+        std::memcpy(buf, file_->data() + offset, size);
+        return size;
+    }
+
+    virtual std::string name() const { return name_; }
+
+    virtual void close() const {}
+
+    virtual long size() const { return stat_.size; }
+
+    virtual const http::Header::list *headers() const { return &headers_; }
+
+private:
+    MappedFile::pointer file_;
+    vs::FileStat stat_;
+    std::string name_;
+    Sink::FileInfo fs_;
+    http::Header::list headers_;
+    std::size_t offset_;
+    std::size_t end_;
+};
+
+/** Window of memory-mapped file.
+ */
+struct MappedWindow {
+    MappedFile::pointer file;
+    std::size_t offset;
+    std::size_t size;
+};
+
+/** Maps file backing given stream and clips window to the stream's extents.
+ *  Returns none if stream is not backed by a file or mapping fails.
+ */
+boost::optional<MappedWindow> mapWindow(const vs::IStream::pointer &stream
+                                        , std::size_t offset
+                                        , std::size_t size)
+{
+    const auto rofd(stream->fd());
+    if (!rofd) { return boost::none; }
+
+    auto file(MappedFile::map(rofd->fd));
+    if (!file) { return boost::none; }
+
+    // window inside mapped file
+    const auto windowSize(rofd->end - rofd->start);
+    if (offset > windowSize) { offset = windowSize; }
+    if (size > (windowSize - offset)) { size = windowSize - offset; }
+
+    return MappedWindow{ file, rofd->start + offset, size };
+}
+
+/** Serves shared in-memory buffer. Each chunk requested by libhttp is copied
+ *  from the buffer (read() interface), the buffer itself is not duplicated.
+ */
+class SharedBufferDataSource : public http::ServerSink::DataSource {
+public:
+    SharedBufferDataSource(const SharedBuffer &buffer
+                           , const Sink::FileInfo &stat
+                           , const std::string &name = "<memory>")
+        : buffer_(buffer), fs_(stat), name_(name), headers_(stat.headers)
+    {}
+
+    virtual http::SinkBase::FileInfo stat() const { return fs_; }
+
+    virtual std::size_t read(char *buf, std::size_t size, std::size_t off) {
+        if (off > buffer_->size()) { return 0; }
+        auto left(buffer_->size() - off);
+        if (size > left) { size = left; }
+        std::memcpy(buf, buffer_->data() + off, size);
+        return size;
+    }
+
+    virtual std::string name() const { return name_; }
+
+    virtual void close() const {}
+
+    virtual long size() const { return buffer_->size(); }
+
+    virtual const http::Header::list *headers() const { return &headers_; }
+
+private:
+    SharedBuffer buffer_;
+    Sink::FileInfo fs_;
+    std::string name_;
+    http::Header::list headers_;
+};
+
 class RoArchiveDataSource : public http::SinkBase::DataSource
 {
 public:
@@ -248,9 +459,163 @@ std::size_t RoArchiveDataSource::read(char *buf, std::size_t size
 
 } // namespace
 
+bool Sink::fileContent(const vs::IStream::pointer &stream
+                       , FileClass fileClass, std::size_t offset
+                       , std::size_t size, bool gzipped)
+{
+    const auto window(mapWindow(stream, offset, size));
+
+    const auto mapped([&]() -> bool
+    {
+        sink_->content(std::make_shared<MappedDataSource>
+                       (window->file, stream, fileClass
+                        , &locationConfig_.fileClassSettings
+                        , window->offset, window->size, gzipped));
+        return true;
+    });
+
+    // small or hot window: served from page cache without blocking
+    if (window && ((window->size <= constants::MappedSmallLimit)
+                   || window->file->resident(window->offset, window->size)))
+    {
+        return mapped();
+    }
+
+    // cold window: read without blocking this thread on page faults
+    if (asyncContent(stream, fileClass, offset, size, gzipped)) {
+        return true;
+    }
+
+    // too big or no asynchronous I/O
+    if (window) { return mapped(); }
+
+    return false;
+}
+
+bool Sink::asyncContent(const vs::IStream::pointer &stream
+                        , FileClass fileClass, std::size_t offset
+                        , std::size_t size, bool gzipped)
+{
+    if (!asyncReader_ || !asyncReader_->available()) { return false; }
+
+    const auto rofd(stream->fd());
+    if (!rofd) { return false; }
+
+    // clip window
+    const auto windowSize(rofd->end - rofd->start);
+    if (offset > windowSize) { offset = windowSize; }
+    if (size > (windowSize - offset)) { size = windowSize - offset; }
+    if (size > constants::AsyncReadLimit) { return false; }
+
+    const auto fs(stream->stat());
+    FileInfo stat(fs.contentType, fs.lastModified);
+    stat.setFileClass(fileClass);
+    if (gzipped) { stat.headers.emplace_back("Content-Encoding", "gzip"); }
+    const auto fi(update(stat));
+
+    // NB: stream is held until read is finished to keep file open
+    auto sink(sink_);
+    return asyncReader_->read(rofd->fd, rofd->start + offset, size
+                              , [sink, stream, fi](const std::error_code &ec
+                                                   , std::string &data)
+    {
+        stream->close();
+        if (ec) {
+            LOG(err2) << "Failed to read from " << stream->name()
+                      << ": <" << ec << ">.";
+            return sink->error(std::make_exception_ptr
+                               (std::system_error(ec, stream->name())));
+        }
+        // hand buffer over, no extra copy of the whole data
+        sink->content(std::make_shared<SharedBufferDataSource>
+                      (std::make_shared<const std::string>(std::move(data))
+                       , fi, stream->name()));
+    });
+}
+
+bool Sink::bufferedContent(const vs::IStream::pointer &stream
+                           , FileClass fileClass, std::size_t offset
+                           , std::size_t size, bool gzipped)
+{
+    const auto limit(locationConfig_.bufferLimit);
+    if (!limit) { return false; }
+
+    const auto fs(stream->stat());
+
+    // clip window
+    const std::size_t total(fs.size);
+    if (offset > total) { offset = total; }
+    if (size > (total - offset)) { size = total - offset; }
+    if (size > limit) { return false; }
+
+    // read whole window
+    auto &pool(BufferPool::instance());
+    auto buffer(pool.get(size));
+    buffer->resize(size);
+    stream->get().exceptions(std::ios::badbit);
+    std::size_t done(0);
+    while (done < size) {
+        const auto r(stream->read(&(*buffer)[done], size - done
+                                  , offset + done));
+        if (!r) { break; }
+        done += r;
+    }
+    buffer->resize(done);
+
+    // release stream before transmission starts
+    stream->close();
+
+    FileInfo stat(fs.contentType, fs.lastModified);
+    stat.setFileClass(fileClass);
+    if (gzipped) { stat.headers.emplace_back("Content-Encoding", "gzip"); }
+    content(pool.share(std::move(buffer)), stat);
+    return true;
+}
+
+bool Sink::bufferedContent(const roarchive::IStream::pointer &stream
+                           , const std::string &contentType
+                           , FileClass fileClass
+                           , const std::string &trasferEncoding)
+{
+    const auto limit(locationConfig_.bufferLimit);
+    if (!limit) { return false; }
+
+    const auto size(stream->size());
+    if (!size || (*size > limit)) { return false; }
+
+    auto &pool(BufferPool::instance());
+    auto buffer(pool.get(*size));
+    buffer->resize(*size);
+    stream->get().read(&(*buffer)[0], *size);
+    buffer->resize(stream->get().gcount());
+
+    // release stream before transmission starts
+    stream->close();
+
+    FileInfo stat(contentType, stream->timestamp());
+    stat.setFileClass(fileClass);
+    if (!trasferEncoding.empty()) {
+        stat.headers.emplace_back("Content-Encoding", trasferEncoding);
+    }
+    content(pool.share(std::move(buffer)), stat);
+    return true;
+}
+
 void Sink::content(vs::IStream::pointer &&stream, FileClass fileClass
                    , bool gzipped)
 {
+    if (fileContent(stream, fileClass, 0
+                    , std::numeric_limits<std::size_t>::max(), gzipped))
+    {
+        return;
+    }
+
+    if (bufferedContent(stream, fileClass, 0
+                        , std::numeric_limits<std::size_t>::max(), gzipped))
+    {
+        return;
+    }
+
     sink_->content(std::make_shared<IStreamDataSource>
                    (std::move(stream), fileClass
                     , &locationConfig_.fileClassSettings
@@ -261,6 +626,12 @@ void Sink::content(vs::IStream::pointer &&stream
                    , FileClass fileClass, std::size_t offset, std::size_t size
                    , bool gzipped)
 {
+    if (fileContent(stream, fileClass, offset, size, gzipped)) { return; }
+
+    if (bufferedContent(stream, fileClass, offset, size, gzipped)) {
+        return;
+    }
+
     sink_->content(std::make_shared<SubIStreamDataSource>
                    (std::move(stream), fileClass
                     , &locationConfig_.fileClassSettings
@@ -271,12 +642,22 @@ void Sink::content(roarchive::IStream::pointer &&stream
                    , const std::string &contentType, FileClass fileClass
                    , const std::string &trasferEncoding)
 {
+    if (bufferedContent(stream, contentType, fileClass, trasferEncoding)) {
+        return;
+    }
+
     sink_->content(std::make_shared<RoArchiveDataSource>
                    (std::move(stream), contentType
                     , fileClass, &locationConfig_.fileClassSettings
                     , trasferEncoding));
 }
 
+void Sink::content(const SharedBuffer &data, const FileInfo &stat)
+{
+    sink_->content(std::make_shared<SharedBufferDataSource>
+                   (data, update(stat)));
+}
+
 void Sink::content(const vs::SupportFile &data)
 {
     if (!data.isTemplate) {
@@ -287,6 +668,14 @@ void Sink::content(const vs::SupportFile &data)
         return;
     }
 
+    if (const auto *expanded = locationConfig_.expanded(data)) {
+        // pre-expanded at configuration time
+        FileInfo stat(data.contentType, expanded->lastModified);
+        stat.setFileClass(FileClass::support).setETag(expanded->etag);
+        content(expanded->data.data(), expanded->data.size(), stat, false);
+        return;
+    }
+
     // content is expanded -> modified now!
     FileInfo stat(data.contentType);
     stat.setFileClass(FileClass::support);
@@ -298,12 +687,37 @@ void Sink::error(const std::exception_ptr &exc)
     sink_->error(exc);
 }
 
+void Sink::error(const std::exception_ptr &exc, FileClass fileClass)
+{
+    sink_->error
+        (exc, update(Sink::FileInfo().setFileClass(fileClass)).cacheControl);
+}
+
 Sink::FileInfo& Sink::FileInfo::setFileClass(FileClass fc)
 {
     fileClass = fc;
     return *this;
 }
 
+Sink::FileInfo& Sink::FileInfo::setETag(const std::string &etag)
+{
+    headers.emplace_back("ETag", etag);
+    return *this;
+}
+
+std::string makeETag(const void *data, std::size_t size)
+{
+    // 64-bit FNV-1a
+    std::uint64_t hash(0xcbf29ce484222325ull);
+    const auto *p(static_cast<const unsigned char*>(data));
+    for (const auto *e(p + size); p != e; ++p) {
+        hash ^= *p;
+        hash *= 0x100000001b3ull;
+    }
+
+    return str(boost::format("\"%016x-%x\"") % hash % size);
+}
+
 Sink::FileInfo& Sink::FileInfo::setMaxAge(const boost::optional<long> &ma)
 {
     cacheControl.maxAge = ma;
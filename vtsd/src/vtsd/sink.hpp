@@ -46,6 +46,7 @@
 #include "fileclass.hpp"
 #include "error.hpp"
 #include "config.hpp"
+#include "asyncreader.hpp"
 
 namespace vs = vtslibs::storage;
 
@@ -61,6 +62,16 @@ struct Aborter {
     virtual void setAborter(const AbortedCallback&) {};
 };
 
+/** Immutable reference-counted buffer, kept alive until response is sent.
+ *  Sending does not duplicate the whole buffer, but libhttp still copies it
+ *  chunk by chunk into its output buffer.
+ */
+typedef std::shared_ptr<const std::string> SharedBuffer;
+
+/** Computes (strong) entity tag of given data.
+ */
+std::string makeETag(const void *data, std::size_t size);
+
 /** Wraps libhttp's sink.
  */
 class Sink : public Aborter {
@@ -82,13 +93,20 @@ public:
         FileInfo& setMaxAge(const boost::optional<long> &maxAge);
         FileInfo& setStaleWhileRevalidate(long stale);
 
+        /** Adds ETag header.
+         */
+        FileInfo& setETag(const std::string &etag);
+
         FileClass fileClass;
         http::Header::list headers;
     };
 
     Sink(const http::ServerSink::pointer &sink
-         , const LocationConfig &locationConfig)
-        : sink_(sink), locationConfig_(locationConfig) {}
+         , const LocationConfig &locationConfig
+         , AsyncReader *asyncReader = nullptr)
+        : sink_(sink), locationConfig_(locationConfig)
+        , asyncReader_(asyncReader)
+    {}
 
     /** Sends content to client.
      * \param data data top send
@@ -96,6 +114,14 @@ public:
      */
     void content(const std::string &data, const FileInfo &stat);
 
+    /** Sends shared buffer to client. Buffer is held until response is sent
+     *  and is read chunk by chunk by libhttp (i.e. each chunk is copied into
+     *  libhttp's output buffer).
+     * \param data data to send
+     * \param stat file info (size is ignored)
+     */
+    void content(const SharedBuffer &data, const FileInfo &stat);
+
     /** Sends support file to client.
      * \param data data to send
      */
@@ -176,6 +202,11 @@ public:
      */
     template <typename T> void error(const T &exc);
 
+    /** Sends given error to the client. Add file class to set caching (i.e.
+     *  cacheable negative response).
+     */
+    template <typename T> void error(const T &exc, FileClass fileClass);
+
     /** Checks wheter client aborted request.
      *  Throws RequestAborted exception when true.
      */
@@ -194,11 +225,50 @@ private:
      */
     void error(const std::exception_ptr &exc);
 
+    /** Sends given error to the client, with caching set by file class.
+     */
+    void error(const std::exception_ptr &exc, FileClass fileClass);
+
     FileInfo update(const FileInfo &stat) const;
 
+    /** Sends (window of) file-backed stream. Small or page cache resident
+     *  windows are served from memory mapping, cold ones are read via
+     *  asyncContent and mapping is the fallback when asynchronous reads are
+     *  not available. Returns false if stream is not backed by a file.
+     */
+    bool fileContent(const vs::IStream::pointer &stream
+                     , FileClass fileClass, std::size_t offset
+                     , std::size_t size, bool gzipped);
+
+    /** Tries to read (window of) file-backed stream asynchronously and send it
+     *  when read. Returns false if not applicable or if the read has been
+     *  refused (e.g. reader is being stopped).
+     */
+    bool asyncContent(const vs::IStream::pointer &stream
+                      , FileClass fileClass, std::size_t offset
+                      , std::size_t size, bool gzipped);
+
+    /** Reads (window of) stream into memory and sends it if it fits into
+     *  location's buffer limit. Returns false if not applicable.
+     */
+    bool bufferedContent(const vs::IStream::pointer &stream
+                         , FileClass fileClass, std::size_t offset
+                         , std::size_t size, bool gzipped);
+
+    /** Ditto for archive stream.
+     */
+    bool bufferedContent(const roarchive::IStream::pointer &stream
+                         , const std::string &contentType
+                         , FileClass fileClass
+                         , const std::string &trasferEncoding);
+
     http::ServerSink::pointer sink_;
 
     const LocationConfig &locationConfig_;
+
+    /** Asynchronous reader, may be null.
+     */
+    AsyncReader *asyncReader_;
 };
 
 // inlines
@@ -209,6 +279,12 @@ inline void Sink::error(const T &exc)
     error(std::make_exception_ptr(exc));
 }
 
+template <typename T>
+inline void Sink::error(const T &exc, FileClass fileClass)
+{
+    error(std::make_exception_ptr(exc), fileClass);
+}
+
 inline void Sink::error() { error(std::current_exception()); }
 
 inline void Sink::content(const std::string &data, const FileInfo &stat) {
@@ -0,0 +1,316 @@
+/**
+ * Copyright (c) 2021 Melown Technologies SE
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * *  Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * *  Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/** Benchmark of asynchronous reads (AsyncReader) against blocking reads done
+ *  by a pool of (HTTP-like) threads on slow storage.
+ *
+ *  Usage: vtsd-asyncreader-bench [latency-ms [file]]
+ *
+ *  Without file, storage with given latency and unlimited parallelism is
+ *  emulated: every read goes to its own pipe which is filled by a delayer
+ *  thread latency after the read has been issued (stand-in for FUSE
+ *  filesystem with delayed replies).
+ *
+ *  With file, random windows of given file are read; page cache is dropped
+ *  for the file before each run. Use file on artificially slow block device,
+ *  e.g. dm-delay on top of a loop device:
+ *
+ *      losetup /dev/loop0 image
+ *      dmsetup create slow --table "0 $(blockdev --getsz /dev/loop0) \
+ *          delay /dev/loop0 0 20"
+ *
+ *  (latency argument is ignored in this mode).
+ */
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "../asyncreader.hpp"
+
+namespace {
+
+typedef std::chrono::steady_clock Clock;
+
+const std::size_t ReadCount(256);
+const std::size_t ThreadCount(8);
+const std::size_t ChunkSize(1 << 14);
+const unsigned int QueueDepth(64);
+
+double since(const Clock::time_point &start)
+{
+    return std::chrono::duration<double, std::milli>
+        (Clock::now() - start).count();
+}
+
+/** Source of slow reads.
+ */
+class Storage {
+public:
+    virtual ~Storage() {}
+
+    /** Issues read #index: returns file descriptor and offset to read from.
+     */
+    virtual std::pair<int, std::size_t> issue(std::size_t index) = 0;
+
+    /** Blocking read.
+     */
+    virtual ::ssize_t read(int fd, char *buf, std::size_t size
+                           , std::size_t offset) = 0;
+
+    /** Read #index is done.
+     */
+    virtual void done(std::size_t) {}
+
+    /** Prepares new run.
+     */
+    virtual void reset() {}
+};
+
+/** Pipe-based emulation of storage with given latency.
+ */
+class PipeStorage : public Storage {
+public:
+    PipeStorage(double latency)
+        : latency_(std::chrono::microseconds(long(latency * 1000)))
+        , fds_(ReadCount), stop_(false)
+        , delayer_(&PipeStorage::run, this)
+    {}
+
+    ~PipeStorage() {
+        {
+            std::lock_guard<std::mutex> guard(mutex_);
+            stop_ = true;
+        }
+        cond_.notify_all();
+        delayer_.join();
+    }
+
+    virtual std::pair<int, std::size_t> issue(std::size_t index) {
+        int fds[2];
+        if (::pipe(fds)) { std::perror("pipe"); std::exit(EXIT_FAILURE); }
+        fds_[index] = fds[0];
+        {
+            std::lock_guard<std::mutex> guard(mutex_);
+            pending_.emplace(Clock::now() + latency_, fds[1]);
+        }
+        cond_.notify_all();
+        return { fds[0], 0 };
+    }
+
+    virtual ::ssize_t read(int fd, char *buf, std::size_t size
+                           , std::size_t) {
+        return ::read(fd, buf, size);
+    }
+
+    virtual void done(std::size_t index) { ::close(fds_[index]); }
+
+private:
+    void run() {
+        const std::string chunk(ChunkSize, 'x');
+        std::unique_lock<std::mutex> lock(mutex_);
+        while (!stop_) {
+            if (pending_.empty()) { cond_.wait(lock); continue; }
+            const auto first(pending_.begin());
+            if (Clock::now() < first->first) {
+                cond_.wait_until(lock, first->first);
+                continue;
+            }
+            const auto fd(first->second);
+            pending_.erase(first);
+            if (::write(fd, chunk.data(), chunk.size()) < 0) {
+                std::perror("write");
+            }
+            ::close(fd);
+        }
+    }
+
+    const Clock::duration latency_;
+    std::vector<int> fds_;
+
+    std::mutex mutex_;
+    std::condition_variable cond_;
+    std::multimap<Clock::time_point, int> pending_;
+    bool stop_;
+    std::thread delayer_;
+};
+
+/** Real file, page cache dropped before each run.
+ */
+class FileStorage : public Storage {
+public:
+    FileStorage(const char *path)
+        : fd_(::open(path, O_RDONLY))
+    {
+        struct ::stat st;
+        if ((fd_ < 0) || ::fstat(fd_, &st)) {
+            std::perror(path);
+            std::exit(EXIT_FAILURE);
+        }
+
+        std::mt19937 gen(42);
+        std::uniform_int_distribution<std::size_t>
+            dist(0, (st.st_size - ChunkSize) / ChunkSize);
+        for (std::size_t i(0); i < ReadCount; ++i) {
+            offsets_.push_back(dist(gen) * ChunkSize);
+        }
+    }
+
+    ~FileStorage() { ::close(fd_); }
+
+    virtual std::pair<int, std::size_t> issue(std::size_t index) {
+        return { fd_, offsets_[index] };
+    }
+
+    virtual ::ssize_t read(int fd, char *buf, std::size_t size
+                           , std::size_t offset) {
+        return ::pread(fd, buf, size, offset);
+    }
+
+    virtual void reset() {
+        ::posix_fadvise(fd_, 0, 0, POSIX_FADV_DONTNEED);
+    }
+
+private:
+    int fd_;
+    std::vector<std::size_t> offsets_;
+};
+
+/** ThreadCount threads, each doing blocking reads one by one.
+ */
+void blocking(Storage &storage)
+{
+    storage.reset();
+    std::atomic<std::size_t> next(0);
+    const auto start(Clock::now());
+
+    std::vector<std::thread> threads;
+    for (std::size_t t(0); t < ThreadCount; ++t) {
+        threads.emplace_back([&]()
+        {
+            std::vector<char> buf(ChunkSize);
+            for (std::size_t index; (index = next++) < ReadCount; ) {
+                const auto source(storage.issue(index));
+                std::size_t done(0);
+                while (done < ChunkSize) {
+                    const auto res(storage.read(source.first, &buf[done]
+                                                , ChunkSize - done
+                                                , source.second + done));
+                    if (res <= 0) { break; }
+                    done += res;
+                }
+                storage.done(index);
+            }
+        });
+    }
+    for (auto &thread : threads) { thread.join(); }
+
+    std::printf("blocking (%zu threads): %zu reads in %.1f ms\n"
+                , ThreadCount, ReadCount, since(start));
+}
+
+/** One thread submitting all reads to AsyncReader.
+ */
+void async(Storage &storage)
+{
+    AsyncReader reader(QueueDepth, ThreadCount);
+    if (!reader.available()) {
+        std::printf("async: io_uring not available\n");
+        return;
+    }
+
+    storage.reset();
+    std::mutex mutex;
+    std::condition_variable cond;
+    std::size_t remaining(ReadCount), failed(0);
+
+    // time spent in storage emulation, not in reader
+    double issuing(0.0);
+
+    const auto start(Clock::now());
+    for (std::size_t index(0); index < ReadCount; ++index) {
+        const auto issueStart(Clock::now());
+        const auto source(storage.issue(index));
+        issuing += since(issueStart);
+
+        reader.read(source.first, source.second, ChunkSize
+                    , [&, index](const std::error_code &ec, std::string&)
+        {
+            storage.done(index);
+            std::lock_guard<std::mutex> guard(mutex);
+            if (ec) { ++failed; }
+            if (!--remaining) { cond.notify_all(); }
+        });
+    }
+    const auto submitted(since(start));
+
+    std::unique_lock<std::mutex> lock(mutex);
+    cond.wait(lock, [&]() { return !remaining; });
+
+    std::printf("async (queue depth %u): %zu reads in %.1f ms"
+                " (submitting thread busy %.2f ms, of which %.2f ms in storage"
+                " emulation; %zu failed)\n"
+                , QueueDepth, ReadCount, since(start), submitted, issuing
+                , failed);
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    const double latency((argc > 1) ? std::atof(argv[1]) : 20.0);
+
+    // delayer must not die when reader gives up
+    ::signal(SIGPIPE, SIG_IGN);
+
+    std::unique_ptr<Storage> storage;
+    if (argc > 2) {
+        std::printf("file %s, %zu x %zu B random reads\n", argv[2]
+                    , ReadCount, ChunkSize);
+        storage.reset(new FileStorage(argv[2]));
+    } else {
+        std::printf("emulated storage, latency %.1f ms, %zu x %zu B reads\n"
+                    , latency, ReadCount, ChunkSize);
+        storage.reset(new PipeStorage(latency));
+    }
+
+    blocking(*storage);
+    async(*storage);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,127 @@
+/**
+ * Copyright (c) 2021 Melown Technologies SE
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * *  Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * *  Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <future>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <boost/test/unit_test.hpp>
+
+#include "../asyncreader.hpp"
+
+#include "tmpfile.hpp"
+
+namespace {
+
+/** Result of one asynchronous read.
+ */
+typedef std::future<std::pair<std::error_code, std::string>> Pending;
+
+Pending read(AsyncReader &reader, int fd, std::size_t offset
+             , std::size_t size)
+{
+    auto promise(std::make_shared
+                 <std::promise<std::pair<std::error_code, std::string>>>());
+    auto future(promise->get_future());
+    BOOST_REQUIRE(reader.read(fd, offset, size
+                              , [promise](const std::error_code &ec
+                                          , std::string &data)
+    {
+        promise->set_value(std::make_pair(ec, std::move(data)));
+    }));
+    return future;
+}
+
+} // namespace
+
+BOOST_AUTO_TEST_SUITE(asyncreader)
+
+BOOST_AUTO_TEST_CASE(read_ranges)
+{
+    AsyncReader reader(32, 2);
+    if (!reader.available()) {
+        BOOST_TEST_MESSAGE("io_uring not available, skipping.");
+        return;
+    }
+
+    TemporaryPath tmp;
+    std::string content(1 << 20, '\0');
+    for (std::size_t i(0); i < content.size(); ++i) {
+        content[i] = char(i * 13);
+    }
+    tmp.write(content);
+
+    const auto fd(::open(tmp.path().c_str(), O_RDONLY));
+    BOOST_REQUIRE(fd >= 0);
+
+    // many concurrent reads, more than queue depth
+    std::vector<std::pair<std::size_t, Pending>> pending;
+    for (std::size_t offset(0); offset < content.size(); offset += 10000) {
+        pending.emplace_back(offset, read(reader, fd, offset, 4096));
+    }
+
+    for (auto &item : pending) {
+        const auto res(item.second.get());
+        BOOST_CHECK(!res.first);
+        const auto expected(content.substr(item.first, 4096));
+        BOOST_CHECK(res.second == expected);
+    }
+
+    // short read at EOF is truncated, not an error
+    const auto tail(read(reader, fd, content.size() - 100, 4096).get());
+    BOOST_CHECK(!tail.first);
+    BOOST_CHECK_EQUAL(tail.second.size(), 100u);
+
+    ::close(fd);
+}
+
+BOOST_AUTO_TEST_CASE(stopped)
+{
+    TemporaryPath tmp;
+    tmp.write("data");
+    const auto fd(::open(tmp.path().c_str(), O_RDONLY));
+    BOOST_REQUIRE(fd >= 0);
+
+    // unavailable or stopped reader refuses reads, callback is never called
+    AsyncReader reader(8, 1);
+    reader.stop();
+    reader.stop();
+
+    bool called(false);
+    BOOST_CHECK(!reader.read(fd, 0, 4, [&](const std::error_code&
+                                           , std::string&)
+    {
+        called = true;
+    }));
+    BOOST_CHECK(!called);
+
+    ::close(fd);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
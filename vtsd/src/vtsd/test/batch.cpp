@@ -0,0 +1,138 @@
+/**
+ * Copyright (c) 2021 Melown Technologies SE
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * *  Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * *  Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+#include "../error.hpp"
+#include "../delivery/vts/batch.hpp"
+
+namespace {
+
+/** Little-endian reader of serialized batch.
+ */
+struct Reader {
+    const std::string &data;
+    std::size_t offset;
+
+    Reader(const std::string &data) : data(data), offset(0) {}
+
+    std::uint32_t read(std::size_t size) {
+        BOOST_REQUIRE(offset + size <= data.size());
+        std::uint32_t value(0);
+        for (std::size_t i(size); i; --i) {
+            value = (value << 8) | std::uint8_t(data[offset + i - 1]);
+        }
+        offset += size;
+        return value;
+    }
+
+    std::string string(std::size_t size) {
+        BOOST_REQUIRE(offset + size <= data.size());
+        offset += size;
+        return data.substr(offset - size, size);
+    }
+};
+
+TileFilePayload payload(const std::string &data, bool gzipped
+                        , std::time_t lastModified)
+{
+    TileFilePayload p;
+    p.data = data;
+    p.gzipped = gzipped;
+    p.lastModified = lastModified;
+    return p;
+}
+
+} // namespace
+
+BOOST_AUTO_TEST_SUITE(batch)
+
+BOOST_AUTO_TEST_CASE(parse)
+{
+    const std::vector<std::string> expected
+        = { "15-1234-5678.bin", "15-1234-5678-0.jpg", "15-1232-5672.meta" };
+
+    BOOST_CHECK(TileBatch::parse("15-1234-5678.bin,15-1234-5678-0.jpg"
+                                 ",,15-1232-5672.meta,", 10)
+                == expected);
+
+    BOOST_CHECK_THROW(TileBatch::parse("", 10), BadRequest);
+    BOOST_CHECK_THROW(TileBatch::parse(",,", 10), BadRequest);
+    BOOST_CHECK_THROW(TileBatch::parse("a,b,c", 2), BadRequest);
+    BOOST_CHECK_THROW(TileBatch::parse(std::string(0x10000, 'a'), 10)
+                      , BadRequest);
+}
+
+BOOST_AUTO_TEST_CASE(parse_limit_clamped)
+{
+    std::string query("a");
+    for (std::size_t i(1); i <= TileBatch::maxCount; ++i) { query += ",a"; }
+
+    // maxCount + 1 entries are refused even with higher limit
+    BOOST_CHECK_THROW(TileBatch::parse(query, TileBatch::maxCount + 10)
+                      , BadRequest);
+    query.resize(query.size() - 2);
+    BOOST_CHECK_EQUAL(TileBatch::parse(query, TileBatch::maxCount + 10)
+                      .size(), TileBatch::maxCount);
+}
+
+BOOST_AUTO_TEST_CASE(serialize)
+{
+    TileBatch batch({ "1-0-0.bin", "1-0-1.bin", "1-1-0.meta" });
+
+    BOOST_CHECK(!batch.set(2, payload("meta", true, 200)));
+    BOOST_CHECK(!batch.fail(1, TileBatch::Status::notFound));
+    BOOST_CHECK(batch.set(0, payload("mesh data", false, 100)));
+    BOOST_CHECK_EQUAL(batch.lastModified(), 200);
+
+    const auto out(batch.serialize());
+    Reader r(*out);
+
+    BOOST_CHECK_EQUAL(r.string(4), "VTSB");
+    BOOST_CHECK_EQUAL(r.read(2), 1u);
+    BOOST_CHECK_EQUAL(r.read(2), 3u);
+
+    const auto entry([&](const std::string &name, TileBatch::Status status
+                         , std::uint32_t flags, const std::string &data)
+    {
+        BOOST_CHECK_EQUAL(r.string(r.read(2)), name);
+        BOOST_CHECK_EQUAL(r.read(1), std::uint32_t(status));
+        BOOST_CHECK_EQUAL(r.read(1), flags);
+        BOOST_CHECK_EQUAL(r.string(r.read(4)), data);
+    });
+
+    entry("1-0-0.bin", TileBatch::Status::ok, 0, "mesh data");
+    entry("1-0-1.bin", TileBatch::Status::notFound, 0, "");
+    entry("1-1-0.meta", TileBatch::Status::ok, 1, "meta");
+
+    BOOST_CHECK_EQUAL(r.offset, out->size());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
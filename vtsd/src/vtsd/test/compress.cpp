@@ -0,0 +1,143 @@
+/**
+ * Copyright (c) 2021 Melown Technologies SE
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * *  Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * *  Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <cstdint>
+#include <string>
+
+#include <boost/program_options.hpp>
+#include <boost/test/unit_test.hpp>
+
+#include "../error.hpp"
+#include "../compress.hpp"
+
+namespace po = boost::program_options;
+
+namespace {
+
+/** Mix of compressible (repeated text) and incompressible (pseudo-random)
+ *  data.
+ */
+std::string sample(std::size_t size)
+{
+    std::string data;
+    data.reserve(size);
+    unsigned int state(12345);
+    while (data.size() < size) {
+        if ((data.size() / 4096) % 2) {
+            state = state * 1103515245 + 12345;
+            data.push_back(char(state >> 16));
+        } else {
+            data.append("{\"geometricError\":1.5,\"content\":{}},");
+        }
+    }
+    data.resize(size);
+    return data;
+}
+
+CompressionConfig config(Compressor compressor, int level)
+{
+    CompressionConfig c;
+    c.compressor = compressor;
+    c.level = level;
+    return c;
+}
+
+void roundTrip(const CompressionConfig &c, const std::string &data)
+{
+    const auto gz(gzip(data, c));
+    BOOST_REQUIRE(gz.size() >= 18);
+
+    // gzip magic and deflate method
+    BOOST_CHECK_EQUAL(std::uint8_t(gz[0]), 0x1f);
+    BOOST_CHECK_EQUAL(std::uint8_t(gz[1]), 0x8b);
+    BOOST_CHECK_EQUAL(std::uint8_t(gz[2]), 0x08);
+
+    BOOST_CHECK(gunzip(gz) == data);
+}
+
+} // namespace
+
+BOOST_AUTO_TEST_SUITE(compress)
+
+BOOST_AUTO_TEST_CASE(zlib_round_trip)
+{
+    const auto data(sample(300000));
+    for (int level(0); level <= 9; ++level) {
+        BOOST_TEST_CONTEXT("level " << level) {
+            roundTrip(config(Compressor::zlib, level), data);
+            roundTrip(config(Compressor::zlib, level), "");
+        }
+    }
+
+    // compressible data shrink
+    BOOST_CHECK_LT(gzip(data, config(Compressor::zlib, 6)).size()
+                   , data.size() * 3 / 4);
+}
+
+BOOST_AUTO_TEST_CASE(libdeflate_round_trip)
+{
+    if (!libdeflateAvailable()) {
+        BOOST_TEST_MESSAGE("libdeflate not available, skipping.");
+        return;
+    }
+
+    const auto data(sample(300000));
+    for (int level(0); level <= 12; ++level) {
+        BOOST_TEST_CONTEXT("level " << level) {
+            roundTrip(config(Compressor::libdeflate, level), data);
+            roundTrip(config(Compressor::libdeflate, level), "");
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(invalid_input)
+{
+    const auto gz(gzip(sample(10000), config(Compressor::zlib, 6)));
+
+    BOOST_CHECK_THROW(gunzip("not a gzip stream"), InternalError);
+    BOOST_CHECK_THROW(gunzip(gz.substr(0, gz.size() / 2)), InternalError);
+}
+
+BOOST_AUTO_TEST_CASE(configure)
+{
+    po::variables_map vars;
+
+    auto zlib(config(Compressor::zlib, 10));
+    BOOST_CHECK_THROW(zlib.configure(vars), po::validation_error);
+    zlib.level = -1;
+    BOOST_CHECK_THROW(zlib.configure(vars), po::validation_error);
+
+    auto libdeflate(config(Compressor::libdeflate, 12));
+    libdeflate.configure(vars);
+    if (libdeflateAvailable()) {
+        BOOST_CHECK(libdeflate == config(Compressor::libdeflate, 12));
+    } else {
+        // falls back to zlib with clamped level
+        BOOST_CHECK(libdeflate == config(Compressor::zlib, 9));
+    }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,126 @@
+/**
+ * Copyright (c) 2021 Melown Technologies SE
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * *  Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * *  Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/** Benchmark of physical -> 3D Tiles vertex conversion: closed-form batch
+ *  conversion (GeographicToGeocentric) against per-vertex loop over generic
+ *  (PROJ based) convertor, i.e. what Convertors::convert does otherwise.
+ *
+ *  Usage: vtsd-convertors-bench [points]
+ *
+ *  NB: with geocentric physical SRS (the usual setup) there is nothing to
+ *  convert at all, therefore only geographic physical SRS is measured.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+
+#include "geo/srsdef.hpp"
+
+#include "../delivery/vts/tdt2vts/convertors.hpp"
+
+namespace {
+
+typedef std::chrono::steady_clock Clock;
+
+const int Runs(5);
+
+const char *WgsProj("+proj=longlat +datum=WGS84 +no_defs");
+const double WgsA(6378137.0);
+const double WgsF(1.0 / 298.257223563);
+
+math::Points3 makePoints(std::size_t count)
+{
+    std::mt19937 gen(42);
+    std::uniform_real_distribution<double> lon(-180.0, 180.0);
+    std::uniform_real_distribution<double> lat(-90.0, 90.0);
+    std::uniform_real_distribution<double> h(-500.0, 9000.0);
+
+    math::Points3 points;
+    points.reserve(count);
+    for (std::size_t i(0); i < count; ++i) {
+        points.emplace_back(lon(gen), lat(gen), h(gen));
+    }
+    return points;
+}
+
+/** Runs conversion on fresh copy of input, returns best time in ms.
+ */
+template <typename Convert>
+double measure(const math::Points3 &input, math::Points3 &output
+               , const Convert &convert)
+{
+    double best(1e100);
+    for (int run(0); run < Runs; ++run) {
+        output = input;
+        const auto start(Clock::now());
+        convert(output);
+        const std::chrono::duration<double, std::milli>
+            elapsed(Clock::now() - start);
+        best = std::min(best, elapsed.count());
+    }
+    return best;
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    const std::size_t count((argc > 1) ? std::atol(argv[1]) : 1000000);
+    const auto input(makePoints(count));
+
+    const geo::SrsDefinition physical
+        (WgsProj, geo::SrsDefinition::Type::proj4);
+    const vtslibs::vts::CsConvertor generic
+        (physical, geo::geocentric(physical));
+    const vts2tdt::GeographicToGeocentric closedForm
+        { WgsA, WgsF * (2.0 - WgsF) };
+
+    math::Points3 genericOut, closedFormOut;
+    const auto genericTime
+        (measure(input, genericOut, [&](math::Points3 &points)
+        {
+            for (auto &p : points) { p = generic(p); }
+        }));
+    const auto closedFormTime
+        (measure(input, closedFormOut, closedForm));
+
+    double maxDiff(0.0);
+    for (std::size_t i(0); i < count; ++i) {
+        maxDiff = std::max(maxDiff, ublas::norm_2(genericOut[i]
+                                                  - closedFormOut[i]));
+    }
+
+    std::printf("%zu points, best of %d runs\n", count, Runs);
+    std::printf("per-vertex generic: %.1f ms, %.1f ns/point\n"
+                , genericTime, genericTime * 1e6 / count);
+    std::printf("closed-form batch:  %.1f ms, %.1f ns/point\n"
+                , closedFormTime, closedFormTime * 1e6 / count);
+    std::printf("max difference: %g m\n", maxDiff);
+    return EXIT_SUCCESS;
+}
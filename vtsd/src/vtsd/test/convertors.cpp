@@ -0,0 +1,97 @@
+/**
+ * Copyright (c) 2021 Melown Technologies SE
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * *  Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * *  Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <cmath>
+
+#include <boost/test/unit_test.hpp>
+
+#include "../delivery/vts/tdt2vts/convertors.hpp"
+
+namespace {
+
+const double WgsA(6378137.0);
+const double WgsF(1.0 / 298.257223563);
+const double WgsB(WgsA * (1.0 - WgsF));
+
+math::Point3 convert(const vts2tdt::GeographicToGeocentric &conv
+                     , double lon, double lat, double h)
+{
+    math::Points3 points{ math::Point3(lon, lat, h) };
+    conv(points);
+    return points.front();
+}
+
+void check(const math::Point3 &p, double x, double y, double z
+           , double tolerance = 1e-6)
+{
+    BOOST_CHECK_SMALL(p(0) - x, tolerance);
+    BOOST_CHECK_SMALL(p(1) - y, tolerance);
+    BOOST_CHECK_SMALL(p(2) - z, tolerance);
+}
+
+} // namespace
+
+BOOST_AUTO_TEST_SUITE(convertors)
+
+BOOST_AUTO_TEST_CASE(wgs84)
+{
+    const vts2tdt::GeographicToGeocentric conv{ WgsA, WgsF * (2.0 - WgsF) };
+
+    check(convert(conv, 0, 0, 0), WgsA, 0, 0);
+    check(convert(conv, 90, 0, 0), 0, WgsA, 0);
+    check(convert(conv, 180, 0, 0), -WgsA, 0, 0);
+    check(convert(conv, 0, 0, 100), WgsA + 100, 0, 0);
+    check(convert(conv, 0, 90, 0), 0, 0, WgsB);
+    check(convert(conv, 0, -90, 1000), 0, 0, -WgsB - 1000);
+
+    // 45N 45E: prime vertical radius N = a / sqrt(1 - e2 / 2)
+    const double e2(WgsF * (2.0 - WgsF));
+    const double n(WgsA / std::sqrt(1.0 - e2 / 2.0));
+    check(convert(conv, 45, 45, 0), n / 2.0, n / 2.0
+          , n * (1.0 - e2) * std::sqrt(0.5));
+}
+
+BOOST_AUTO_TEST_CASE(sphere)
+{
+    // zero eccentricity, e.g. Mars or Moon reference frames
+    const vts2tdt::GeographicToGeocentric conv{ 1000.0, 0.0 };
+
+    check(convert(conv, 0, 90, 0), 0, 0, 1000.0);
+    check(convert(conv, 45, 45, 0), 500.0, 500.0, 1000.0 * std::sqrt(0.5));
+
+    // all points of a parallel at the same distance from origin
+    math::Points3 points;
+    for (int lon(-180); lon < 180; lon += 15) {
+        points.emplace_back(lon, 30.0, 10.0);
+    }
+    conv(points);
+    for (const auto &p : points) {
+        BOOST_CHECK_CLOSE(std::sqrt(p(0) * p(0) + p(1) * p(1) + p(2) * p(2))
+                          , 1010.0, 1e-9);
+    }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
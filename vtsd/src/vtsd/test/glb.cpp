@@ -0,0 +1,229 @@
+/**
+ * Copyright (c) 2021 Melown Technologies SE
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * *  Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * *  Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+#include <boost/test/unit_test.hpp>
+
+#include "jsoncpp/json.hpp"
+
+#include "../error.hpp"
+#include "../delivery/vts/tdt2vts/glb.hpp"
+
+namespace {
+
+void write32(std::string &out, std::uint32_t value)
+{
+    for (int i(0); i < 4; ++i) {
+        out.push_back(char(value & 0xff));
+        value >>= 8;
+    }
+}
+
+std::uint32_t read32(const std::string &data, std::size_t offset)
+{
+    BOOST_REQUIRE(offset + 4 <= data.size());
+    std::uint32_t value(0);
+    for (int i(3); i >= 0; --i) {
+        value = (value << 8) | std::uint8_t(data[offset + i]);
+    }
+    return value;
+}
+
+std::string padded(std::string s, char c, std::size_t alignment)
+{
+    while (s.size() % alignment) { s.push_back(c); }
+    return s;
+}
+
+const char *GltfJson =
+    "{\"asset\":{\"version\":\"2.0\"},\"scene\":0"
+    ",\"scenes\":[{\"nodes\":[0]}],\"nodes\":[{\"mesh\":0}]"
+    ",\"images\":[{\"uri\":\"tex.jpg\"},{\"uri\":\"other.jpg\"}]"
+    ",\"bufferViews\":[{\"buffer\":0,\"byteOffset\":0,\"byteLength\":6}]"
+    ",\"buffers\":[{\"byteLength\":6}]}";
+
+/** Builds b3dm with given feature table (JSON and binary) wrapping simple
+ *  GLB with 6-byte binary chunk.
+ */
+std::string b3dm(const std::string &ftJson, const std::string &ftBin = "")
+{
+    const auto json(padded(GltfJson, ' ', 4));
+    const auto bin(padded("\x01\x02\x03\x04\x05\x06", '\0', 4));
+
+    std::string glb;
+    write32(glb, 0x46546c67);
+    write32(glb, 2);
+    write32(glb, 12 + 8 + json.size() + 8 + bin.size());
+    write32(glb, json.size());
+    write32(glb, 0x4e4f534a);
+    glb.append(json);
+    write32(glb, bin.size());
+    write32(glb, 0x004e4942);
+    glb.append(bin);
+
+    const auto ft(padded(ftJson, ' ', 8));
+
+    std::string out("b3dm");
+    write32(out, 1);
+    write32(out, 28 + ft.size() + ftBin.size() + glb.size());
+    write32(out, ft.size());
+    write32(out, ftBin.size());
+    write32(out, 0);
+    write32(out, 0);
+    out.append(ft);
+    out.append(ftBin);
+    out.append(glb);
+    return out;
+}
+
+/** Parsed GLB.
+ */
+struct Glb {
+    Json::Value json;
+    std::string bin;
+
+    Glb(const std::string &data) {
+        BOOST_REQUIRE(data.size() >= 20);
+        BOOST_CHECK_EQUAL(read32(data, 0), 0x46546c67u);
+        BOOST_CHECK_EQUAL(read32(data, 4), 2u);
+        BOOST_REQUIRE_EQUAL(read32(data, 8), data.size());
+
+        const auto jsonSize(read32(data, 12));
+        BOOST_CHECK_EQUAL(read32(data, 16), 0x4e4f534au);
+        BOOST_CHECK_EQUAL(jsonSize % 4, 0u);
+
+        Json::Reader reader;
+        BOOST_REQUIRE(reader.parse(data.substr(20, jsonSize), json));
+
+        const auto binChunk(20 + jsonSize);
+        if (binChunk < data.size()) {
+            const auto binSize(read32(data, binChunk));
+            BOOST_CHECK_EQUAL(read32(data, binChunk + 4), 0x004e4942u);
+            BOOST_CHECK_EQUAL(binSize % 4, 0u);
+            BOOST_REQUIRE_EQUAL(binChunk + 8 + binSize, data.size());
+            bin = data.substr(binChunk + 8);
+        }
+    }
+
+    void checkTranslation(double x, double y, double z) const {
+        // new root node appended after original ones
+        const auto &scene(json["scenes"][0]["nodes"]);
+        BOOST_REQUIRE_EQUAL(scene.size(), 1u);
+        BOOST_REQUIRE_EQUAL(scene[0].asUInt(), 1u);
+
+        const auto &root(json["nodes"][1]);
+        BOOST_CHECK_EQUAL(root["children"].size(), 1u);
+        BOOST_CHECK_EQUAL(root["children"][0].asUInt(), 0u);
+
+        const auto &t(root["translation"]);
+        BOOST_REQUIRE_EQUAL(t.size(), 3u);
+        BOOST_CHECK_EQUAL(t[0].asDouble(), x);
+        BOOST_CHECK_EQUAL(t[1].asDouble(), y);
+        BOOST_CHECK_EQUAL(t[2].asDouble(), z);
+    }
+};
+
+} // namespace
+
+BOOST_AUTO_TEST_SUITE(glb)
+
+BOOST_AUTO_TEST_CASE(rtc_center)
+{
+    // ECEF (Z-up) -> glTF (Y-up): (x, y, z) -> (x, z, -y)
+    const Glb glb(vts2tdt::b3dm2glb
+                  (b3dm("{\"BATCH_LENGTH\":0,\"RTC_CENTER\":[1,2,3]}")));
+    glb.checkTranslation(1, 3, -2);
+
+    // binary chunk kept intact
+    BOOST_CHECK_EQUAL(glb.bin.substr(0, 6), "\x01\x02\x03\x04\x05\x06");
+}
+
+BOOST_AUTO_TEST_CASE(rtc_center_binary)
+{
+    std::string ftBin;
+    for (double v : { 4000000.5, -1000.25, 4800000.0 }) {
+        char raw[8];
+        std::memcpy(raw, &v, sizeof(raw));
+        ftBin.append(raw, sizeof(raw));
+    }
+
+    const Glb glb(vts2tdt::b3dm2glb
+                  (b3dm("{\"BATCH_LENGTH\":0"
+                        ",\"RTC_CENTER\":{\"byteOffset\":0}}", ftBin)));
+    glb.checkTranslation(4000000.5, 4800000.0, 1000.25);
+}
+
+BOOST_AUTO_TEST_CASE(no_rtc_center)
+{
+    const Glb glb(vts2tdt::b3dm2glb(b3dm("{\"BATCH_LENGTH\":0}")));
+    BOOST_CHECK_EQUAL(glb.json["nodes"].size(), 1u);
+    BOOST_CHECK_EQUAL(glb.json["scenes"][0]["nodes"][0].asUInt(), 0u);
+    BOOST_CHECK_EQUAL(glb.json["images"][0]["uri"].asString(), "tex.jpg");
+}
+
+BOOST_AUTO_TEST_CASE(embedded_images)
+{
+    const std::string jpeg("\xff\xd8\xff\xe0 fake jpeg \xff\xd9");
+    const Glb glb(vts2tdt::b3dm2glb(b3dm("{\"BATCH_LENGTH\":0}")
+                                    , { { "tex.jpg", jpeg } }));
+
+    // listed image is moved into binary chunk
+    const auto &image(glb.json["images"][0]);
+    BOOST_CHECK(!image.isMember("uri"));
+    BOOST_CHECK_EQUAL(image["mimeType"].asString(), "image/jpeg");
+
+    const auto &view(glb.json["bufferViews"][image["bufferView"].asUInt()]);
+    const auto offset(view["byteOffset"].asUInt());
+    BOOST_CHECK_EQUAL(offset % 4, 0u);
+    BOOST_CHECK_EQUAL(view["byteLength"].asUInt(), jpeg.size());
+    BOOST_CHECK_EQUAL(glb.bin.substr(offset, jpeg.size()), jpeg);
+
+    // unlisted image untouched
+    BOOST_CHECK_EQUAL(glb.json["images"][1]["uri"].asString(), "other.jpg");
+
+    BOOST_CHECK_EQUAL(glb.json["buffers"][0]["byteLength"].asUInt()
+                      , offset + jpeg.size());
+    BOOST_CHECK_LE(offset + jpeg.size(), glb.bin.size());
+}
+
+BOOST_AUTO_TEST_CASE(invalid_input)
+{
+    BOOST_CHECK_THROW(vts2tdt::b3dm2glb(""), FormatError);
+    BOOST_CHECK_THROW(vts2tdt::b3dm2glb(std::string(100, 'x'))
+                      , FormatError);
+
+    const auto valid(b3dm("{\"BATCH_LENGTH\":0}"));
+    BOOST_CHECK_THROW(vts2tdt::b3dm2glb(valid.substr(0, 40)), FormatError);
+
+    // broken feature table JSON
+    BOOST_CHECK_THROW(vts2tdt::b3dm2glb(b3dm("{\"RTC_CENTER\":[1,2")
+                                        ), FormatError);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,186 @@
+/**
+ * Copyright (c) 2021 Melown Technologies SE
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * *  Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * *  Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <cstdint>
+#include <cstring>
+#include <sstream>
+#include <string>
+
+#include <boost/test/unit_test.hpp>
+
+#include "jsoncpp/json.hpp"
+
+#include "../error.hpp"
+#include "../delivery/vts/tdt2vts/implicit.hpp"
+
+namespace {
+
+std::uint64_t read(const std::string &data, std::size_t offset
+                   , std::size_t size)
+{
+    BOOST_REQUIRE(offset + size <= data.size());
+    std::uint64_t value(0);
+    for (std::size_t i(size); i; --i) {
+        value = (value << 8) | std::uint8_t(data[offset + i - 1]);
+    }
+    return value;
+}
+
+/** Parsed binary subtree file.
+ */
+struct Parsed {
+    Json::Value json;
+    std::string bin;
+
+    Parsed(const vts2tdt::Subtree &subtree) {
+        std::ostringstream os;
+        subtree.write(os);
+        const auto data(os.str());
+
+        BOOST_REQUIRE(data.size() >= 24);
+        BOOST_CHECK_EQUAL(data.substr(0, 4), "subt");
+        BOOST_CHECK_EQUAL(read(data, 4, 4), 1u);
+        const auto jsonSize(read(data, 8, 8));
+        const auto binSize(read(data, 16, 8));
+
+        // chunks are 8-byte aligned
+        BOOST_CHECK_EQUAL(jsonSize % 8, 0u);
+        BOOST_CHECK_EQUAL(binSize % 8, 0u);
+        BOOST_REQUIRE_EQUAL(data.size(), 24 + jsonSize + binSize);
+
+        Json::Reader reader;
+        BOOST_REQUIRE(reader.parse(data.substr(24, jsonSize), json));
+        bin = data.substr(24 + jsonSize);
+    }
+
+    /** Returns content of given buffer view.
+     */
+    std::string view(const Json::Value &index) const {
+        const auto &v(json["bufferViews"][index.asUInt()]);
+        BOOST_CHECK_EQUAL(v["byteOffset"].asUInt() % 8, 0u);
+        return bin.substr(v["byteOffset"].asUInt(), v["byteLength"].asUInt());
+    }
+
+    double value(const Json::Value &index, std::size_t i) const {
+        const auto raw(read(view(index), 8 * i, 8));
+        double d;
+        std::memcpy(&d, &raw, sizeof(d));
+        return d;
+    }
+};
+
+} // namespace
+
+BOOST_AUTO_TEST_SUITE(implicit)
+
+BOOST_AUTO_TEST_CASE(morton_layout)
+{
+    vts2tdt::Subtree subtree(2);
+    BOOST_CHECK(subtree.empty());
+
+    // added out of order on purpose
+    subtree.tile(1, 0, 1, false, math::Extents3(0, 0, 0, 1, 1, 1), 3.0);
+    subtree.tile(1, 1, 0, true, math::Extents3(0, 0, 0, 1, 1, 1), 2.0);
+    subtree.tile(0, 0, 0, false, math::Extents3(0, 0, 0, 1, 1, 1), 1.0);
+    subtree.childSubtree(3, 1);
+    BOOST_CHECK(!subtree.empty());
+
+    const Parsed p(subtree);
+
+    // level 0 -> bit 0; level 1: (1, 0) -> morton 1 -> bit 2
+    // , (0, 1) -> morton 2 -> bit 3
+    const auto &tiles(p.json["tileAvailability"]);
+    BOOST_CHECK_EQUAL(tiles["availableCount"].asUInt(), 3u);
+    BOOST_CHECK_EQUAL(p.view(tiles["bitstream"]), std::string("\x0d", 1));
+
+    const auto &content(p.json["contentAvailability"][0]);
+    BOOST_CHECK_EQUAL(content["availableCount"].asUInt(), 1u);
+    BOOST_CHECK_EQUAL(p.view(content["bitstream"]), std::string("\x04", 1));
+
+    // level 2: (3, 1) -> morton 0b0111 = 7
+    const auto &children(p.json["childSubtreeAvailability"]);
+    BOOST_CHECK_EQUAL(children["availableCount"].asUInt(), 1u);
+    BOOST_CHECK_EQUAL(p.view(children["bitstream"])
+                      , std::string("\x80\x00", 2));
+
+    // metadata rows follow bitstream order
+    const auto &properties(p.json["propertyTables"][0]["properties"]);
+    BOOST_CHECK_EQUAL(p.json["propertyTables"][0]["count"].asUInt(), 3u);
+    const auto &errors(properties["geometricError"]["values"]);
+    BOOST_CHECK_EQUAL(p.value(errors, 0), 1.0);
+    BOOST_CHECK_EQUAL(p.value(errors, 1), 2.0);
+    BOOST_CHECK_EQUAL(p.value(errors, 2), 3.0);
+}
+
+BOOST_AUTO_TEST_CASE(bounding_region)
+{
+    vts2tdt::Subtree subtree(1);
+    subtree.tile(0, 0, 0, true
+                 , math::Extents3(0.1, 0.2, -10.0, 0.3, 0.4, 250.0), 5.0);
+
+    const Parsed p(subtree);
+
+    // region is stored as west, south, east, north, min height, max height
+    const auto &region(p.json["propertyTables"][0]["properties"]
+                       ["boundingRegion"]["values"]);
+    BOOST_CHECK_EQUAL(p.view(region).size(), 6 * 8u);
+    BOOST_CHECK_EQUAL(p.value(region, 0), 0.1);
+    BOOST_CHECK_EQUAL(p.value(region, 1), 0.2);
+    BOOST_CHECK_EQUAL(p.value(region, 2), 0.3);
+    BOOST_CHECK_EQUAL(p.value(region, 3), 0.4);
+    BOOST_CHECK_EQUAL(p.value(region, 4), -10.0);
+    BOOST_CHECK_EQUAL(p.value(region, 5), 250.0);
+}
+
+BOOST_AUTO_TEST_CASE(constant_availability)
+{
+    vts2tdt::Subtree subtree(1);
+    subtree.tile(0, 0, 0, false, math::Extents3(0, 0, 0, 1, 1, 1), 1.0);
+
+    const Parsed p(subtree);
+    BOOST_CHECK_EQUAL(p.json["tileAvailability"]["constant"].asInt(), 1);
+    BOOST_CHECK_EQUAL(p.json["contentAvailability"][0]["constant"].asInt()
+                      , 0);
+    BOOST_CHECK_EQUAL(p.json["childSubtreeAvailability"]["constant"].asInt()
+                      , 0);
+}
+
+BOOST_AUTO_TEST_CASE(empty_subtree)
+{
+    const Parsed p(vts2tdt::Subtree(3));
+    BOOST_CHECK_EQUAL(p.json["tileAvailability"]["constant"].asInt(), 0);
+    BOOST_CHECK(!p.json.isMember("buffers"));
+    BOOST_CHECK(p.bin.empty());
+}
+
+BOOST_AUTO_TEST_CASE(levels)
+{
+    BOOST_CHECK_NO_THROW(vts2tdt::Subtree(16));
+    BOOST_CHECK_THROW(vts2tdt::Subtree(17), InternalError);
+    BOOST_CHECK_THROW(vts2tdt::Subtree(40), InternalError);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,106 @@
+/**
+ * Copyright (c) 2021 Melown Technologies SE
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * *  Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * *  Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/** Microbenchmark of access to lazily built config under contention:
+ *  lock-free LazyConfigHolder against mutex taken on every access (i.e. the
+ *  original holder).
+ *
+ *  Usage: vtsd-mapconfig-bench [threads]
+ */
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <boost/optional.hpp>
+#include <boost/utility/in_place_factory.hpp>
+
+#include "../delivery/vts/mapconfig.hpp"
+
+namespace {
+
+const std::size_t AccessCount(1 << 22);
+
+/** Holder taking mutex on every access.
+ */
+template <typename T>
+class MutexHolder {
+public:
+    template <typename ...Args> T& operator()(Args &&...args) const {
+        std::lock_guard<std::mutex> guard(mutex_);
+        if (!data_) { data_ = boost::in_place(std::forward<Args>(args)...); }
+        return *data_;
+    }
+
+private:
+    mutable std::mutex mutex_;
+    mutable boost::optional<T> data_;
+};
+
+template <typename Holder>
+void run(const char *name, std::size_t threadCount)
+{
+    Holder holder;
+    std::vector<long> sums(threadCount);
+
+    const auto start(std::chrono::steady_clock::now());
+    std::vector<std::thread> threads;
+    for (std::size_t t(0); t < threadCount; ++t) {
+        threads.emplace_back([&, t]()
+        {
+            long sum(0);
+            for (std::size_t i(AccessCount / threadCount); i; --i) {
+                sum += holder(1);
+            }
+            sums[t] = sum;
+        });
+    }
+    for (auto &thread : threads) { thread.join(); }
+
+    const std::chrono::duration<double, std::nano>
+        elapsed(std::chrono::steady_clock::now() - start);
+    std::printf("%s, %zu threads: %.1f ms, %.2f ns/access\n"
+                , name, threadCount, elapsed.count() / 1e6
+                , elapsed.count() / AccessCount);
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    const std::size_t threadCount
+        ((argc > 1) ? std::atoi(argv[1])
+         : std::max(2u, std::thread::hardware_concurrency()));
+
+    for (std::size_t t(1); t <= threadCount; t *= 2) {
+        run<MutexHolder<long>>("mutex", t);
+        run<mapconfig::LazyConfigHolder<long>>("lock-free", t);
+    }
+    return EXIT_SUCCESS;
+}
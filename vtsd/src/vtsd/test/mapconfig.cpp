@@ -0,0 +1,91 @@
+/**
+ * Copyright (c) 2021 Melown Technologies SE
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * *  Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * *  Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+#include "../delivery/vts/mapconfig.hpp"
+
+namespace {
+
+/** Slow to construct, counts constructions.
+ */
+struct Counted {
+    static std::atomic<int> count;
+
+    int value;
+
+    Counted(int value) : value(value) {
+        ++count;
+        // widen the race window
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    }
+};
+
+std::atomic<int> Counted::count(0);
+
+} // namespace
+
+BOOST_AUTO_TEST_SUITE(mapconfig)
+
+BOOST_AUTO_TEST_CASE(lazy_holder_concurrent_first_access)
+{
+    const std::size_t threadCount(16);
+
+    for (int round(0); round < 5; ++round) {
+        Counted::count = 0;
+        mapconfig::LazyConfigHolder<Counted> holder;
+
+        std::atomic<bool> go(false);
+        std::vector<const Counted*> seen(threadCount, nullptr);
+        std::vector<std::thread> threads;
+        for (std::size_t t(0); t < threadCount; ++t) {
+            threads.emplace_back([&, t]()
+            {
+                while (!go) { std::this_thread::yield(); }
+                // NB: argument of losers is ignored
+                seen[t] = &holder(int(t));
+            });
+        }
+
+        go = true;
+        for (auto &thread : threads) { thread.join(); }
+
+        // built once, everybody sees the same published object
+        BOOST_CHECK_EQUAL(Counted::count, 1);
+        for (const auto *p : seen) {
+            BOOST_CHECK_EQUAL(p, seen.front());
+        }
+        BOOST_CHECK_EQUAL(&holder(-1), seen.front());
+        BOOST_CHECK_EQUAL(Counted::count, 1);
+    }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
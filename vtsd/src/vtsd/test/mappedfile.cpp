@@ -0,0 +1,144 @@
+/**
+ * Copyright (c) 2021 Melown Technologies SE
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * *  Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * *  Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <memory>
+#include <string>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <boost/test/unit_test.hpp>
+
+#include "../mappedfile.hpp"
+
+#include "tmpfile.hpp"
+
+namespace {
+
+MappedFile::pointer mapFile(const TemporaryPath &tmp)
+{
+    const auto fd(::open(tmp.path().c_str(), O_RDONLY));
+    BOOST_REQUIRE(fd >= 0);
+    auto mf(MappedFile::map(fd));
+    ::close(fd);
+    return mf;
+}
+
+} // namespace
+
+BOOST_AUTO_TEST_SUITE(mappedfile)
+
+BOOST_AUTO_TEST_CASE(content)
+{
+    TemporaryPath tmp;
+    std::string content(100000, '\0');
+    for (std::size_t i(0); i < content.size(); ++i) {
+        content[i] = char(i * 7);
+    }
+    tmp.write(content);
+
+    const auto mf(mapFile(tmp));
+    BOOST_REQUIRE(mf);
+    BOOST_REQUIRE_EQUAL(mf->size(), content.size());
+    BOOST_CHECK(std::string(mf->data(), mf->size()) == content);
+
+    // just read -> resident; out of range spans are trivially resident
+    BOOST_CHECK(mf->resident(0, content.size()));
+    BOOST_CHECK(mf->resident(12345, 10));
+    BOOST_CHECK(mf->resident(content.size(), 10));
+}
+
+BOOST_AUTO_TEST_CASE(shared)
+{
+    TemporaryPath tmp;
+    tmp.write("shared mapping");
+
+    const auto first(mapFile(tmp));
+    const auto second(mapFile(tmp));
+    BOOST_REQUIRE(first);
+    BOOST_CHECK_EQUAL(first, second);
+}
+
+BOOST_AUTO_TEST_CASE(empty)
+{
+    TemporaryPath tmp;
+    tmp.write("");
+    BOOST_CHECK(!mapFile(tmp));
+}
+
+BOOST_AUTO_TEST_CASE(released_by_last_user)
+{
+    TemporaryPath tmp;
+    tmp.write("released mapping");
+
+    std::weak_ptr<const MappedFile> weak;
+    {
+        const auto first(mapFile(tmp));
+        BOOST_REQUIRE(first);
+        weak = first;
+        {
+            const auto second(mapFile(tmp));
+            BOOST_CHECK_EQUAL(first, second);
+        }
+        // one user left
+        BOOST_CHECK(!weak.expired());
+    }
+    BOOST_CHECK(weak.expired());
+
+    // registry has forgotten the mapping, file is mapped anew
+    const auto again(mapFile(tmp));
+    BOOST_REQUIRE(again);
+    BOOST_CHECK_EQUAL(std::string(again->data(), again->size())
+                      , "released mapping");
+}
+
+BOOST_AUTO_TEST_CASE(replaced_file)
+{
+    TemporaryPath tmp;
+    tmp.write("old content");
+    auto old(mapFile(tmp));
+    BOOST_REQUIRE(old);
+
+    // replace file with a new inode, as datasets are updated
+    TemporaryPath replacement;
+    replacement.write("new, longer content");
+    boost::filesystem::rename(replacement.path(), tmp.path());
+
+    const auto current(mapFile(tmp));
+    BOOST_REQUIRE(current);
+    BOOST_CHECK_NE(old, current);
+    BOOST_CHECK_EQUAL(std::string(old->data(), old->size()), "old content");
+    BOOST_CHECK_EQUAL(std::string(current->data(), current->size())
+                      , "new, longer content");
+
+    // dropping old mapping must not affect the current one
+    const std::weak_ptr<const MappedFile> weak(old);
+    old.reset();
+    BOOST_CHECK(weak.expired());
+    BOOST_CHECK_EQUAL(mapFile(tmp), current);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,170 @@
+/**
+ * Copyright (c) 2021 Melown Technologies SE
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * *  Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * *  Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <string>
+
+#include <boost/filesystem.hpp>
+#include <boost/test/unit_test.hpp>
+
+#include "../delivery/vts/tdt2vts/meshcache.hpp"
+
+#include "tmpfile.hpp"
+
+namespace fs = boost::filesystem;
+namespace vts = vtslibs::vts;
+
+namespace {
+
+/** Disk-only cache setup: dataset file and cache root directory.
+ */
+struct Fixture {
+    TemporaryPath dataset;
+    TemporaryPath root;
+    vts2tdt::MeshCacheOptions options;
+    CompressionConfig compression;
+
+    Fixture() {
+        dataset.write("dataset");
+        options.memoryItems = 0;
+        options.dir = root.path();
+        options.diskLimit = 250;
+    }
+
+    vts2tdt::MeshCache::pointer create(unsigned int revision) const {
+        return vts2tdt::MeshCache::create(options, dataset.path(), revision);
+    }
+
+    static vts2tdt::MeshCache::Mesh mesh(char c, std::size_t size
+                                         , std::time_t lastModified = 1000)
+    {
+        return { std::make_shared<const std::string>(size, c)
+                 , lastModified };
+    }
+
+    vts2tdt::MeshCache::Mesh get(vts2tdt::MeshCache &cache
+                                 , unsigned int x) const
+    {
+        return cache.get(vts::TileId(10, x, 0), vts2tdt::MeshFormat::glb
+                         , compression);
+    }
+
+    void put(vts2tdt::MeshCache &cache, unsigned int x
+             , const vts2tdt::MeshCache::Mesh &m) const
+    {
+        cache.put(vts::TileId(10, x, 0), vts2tdt::MeshFormat::glb
+                  , compression, m);
+    }
+
+    std::size_t dirCount() const {
+        return std::distance(fs::directory_iterator(root.path())
+                             , fs::directory_iterator());
+    }
+};
+
+} // namespace
+
+BOOST_FIXTURE_TEST_SUITE(meshcache, Fixture)
+
+BOOST_AUTO_TEST_CASE(disabled)
+{
+    options.dir.clear();
+    BOOST_CHECK(!create(1));
+
+    options.memoryItems = 10;
+    auto cache(create(1));
+    BOOST_REQUIRE(cache);
+    put(*cache, 1, mesh('a', 10));
+    BOOST_CHECK(get(*cache, 1));
+}
+
+BOOST_AUTO_TEST_CASE(persistent)
+{
+    put(*create(1), 1, mesh('a', 100, 12345));
+
+    // new instance (i.e. restart) of the same revision sees the mesh
+    const auto m(get(*create(1), 1));
+    BOOST_REQUIRE(m);
+    BOOST_CHECK(*m.data == std::string(100, 'a'));
+    BOOST_CHECK_EQUAL(m.lastModified, 12345);
+
+    // other format/compression is a different mesh
+    auto cache(create(1));
+    BOOST_CHECK(!cache->get(vts::TileId(10, 1, 0), vts2tdt::MeshFormat::b3dm
+                            , compression));
+}
+
+BOOST_AUTO_TEST_CASE(lru_eviction)
+{
+    auto cache(create(1));
+    put(*cache, 1, mesh('a', 100));
+    put(*cache, 2, mesh('b', 100));
+
+    // touch 1, then make room for 3 -> 2 is evicted
+    BOOST_CHECK(get(*cache, 1));
+    put(*cache, 3, mesh('c', 100));
+
+    BOOST_CHECK(get(*cache, 1));
+    BOOST_CHECK(!get(*cache, 2));
+    BOOST_CHECK(get(*cache, 3));
+
+    // larger than whole disk tier: not stored, nothing evicted
+    put(*cache, 4, mesh('d', 300));
+    BOOST_CHECK(!get(*cache, 4));
+    BOOST_CHECK(get(*cache, 1));
+    BOOST_CHECK(get(*cache, 3));
+}
+
+BOOST_AUTO_TEST_CASE(lowered_limit)
+{
+    {
+        auto cache(create(1));
+        put(*cache, 1, mesh('a', 100));
+        put(*cache, 2, mesh('b', 100));
+    }
+
+    // scan on construction trims directory to new limit
+    options.diskLimit = 150;
+    auto cache(create(1));
+    BOOST_CHECK_EQUAL(bool(get(*cache, 1)) + bool(get(*cache, 2)), 1);
+}
+
+BOOST_AUTO_TEST_CASE(revisions)
+{
+    put(*create(1), 1, mesh('a', 100));
+    BOOST_CHECK_EQUAL(dirCount(), 1u);
+
+    // new revision drops older revision's directory
+    auto cache(create(2));
+    BOOST_CHECK(!get(*cache, 1));
+    BOOST_CHECK_EQUAL(dirCount(), 1u);
+
+    // older revision does not touch newer one
+    put(*cache, 1, mesh('b', 100));
+    create(1);
+    BOOST_CHECK(get(*create(2), 1));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,72 @@
+/**
+ * Copyright (c) 2021 Melown Technologies SE
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * *  Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * *  Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <boost/test/unit_test.hpp>
+
+#include "../delivery/vts/prefetch.hpp"
+
+namespace {
+
+void check(const FileWindow &w, int fd, std::size_t start, std::size_t end)
+{
+    BOOST_CHECK_EQUAL(w.fd, fd);
+    BOOST_CHECK_EQUAL(w.start, start);
+    BOOST_CHECK_EQUAL(w.end, end);
+}
+
+} // namespace
+
+BOOST_AUTO_TEST_SUITE(prefetch)
+
+BOOST_AUTO_TEST_CASE(coalesce_windows)
+{
+    // two tilar files, windows in random order
+    const auto out(coalesce({ { 4, 3000, 4000 }, { 3, 0, 1000 }
+                              , { 3, 1000, 2000 }, { 4, 0, 1000 }
+                              , { 3, 1500, 1800 }, { 3, 2100, 2500 }
+                              , { 3, 10000, 11000 } }
+                            , 200));
+
+    BOOST_REQUIRE_EQUAL(out.size(), 4u);
+    check(out[0], 3, 0, 2500); // adjacent, contained and close windows
+    check(out[1], 3, 10000, 11000); // too far
+    check(out[2], 4, 0, 1000);
+    check(out[3], 4, 3000, 4000);
+}
+
+BOOST_AUTO_TEST_CASE(coalesce_no_gap)
+{
+    const auto out(coalesce({ { 3, 0, 100 }, { 3, 100, 200 }
+                              , { 3, 201, 300 } }, 0));
+
+    BOOST_REQUIRE_EQUAL(out.size(), 2u);
+    check(out[0], 3, 0, 200);
+    check(out[1], 3, 201, 300);
+
+    BOOST_CHECK(coalesce({}, 100).empty());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
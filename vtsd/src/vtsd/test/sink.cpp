@@ -0,0 +1,57 @@
+/**
+ * Copyright (c) 2021 Melown Technologies SE
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * *  Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * *  Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <string>
+
+#include <boost/test/unit_test.hpp>
+
+#include "../sink.hpp"
+
+BOOST_AUTO_TEST_SUITE(sink)
+
+BOOST_AUTO_TEST_CASE(etag_fnv1a)
+{
+    // 64-bit FNV-1a reference vectors, size appended in hex
+    BOOST_CHECK_EQUAL(makeETag("", 0), "\"cbf29ce484222325-0\"");
+    BOOST_CHECK_EQUAL(makeETag("a", 1), "\"af63dc4c8601ec8c-1\"");
+    BOOST_CHECK_EQUAL(makeETag("foobar", 6), "\"85944171f73967e8-6\"");
+}
+
+BOOST_AUTO_TEST_CASE(etag_distinguishes_content)
+{
+    const std::string a(1000, 'x');
+    std::string b(a);
+    b[500] = 'y';
+
+    BOOST_CHECK_EQUAL(makeETag(a.data(), a.size())
+                      , makeETag(a.data(), a.size()));
+    BOOST_CHECK_NE(makeETag(a.data(), a.size())
+                   , makeETag(b.data(), b.size()));
+    BOOST_CHECK_NE(makeETag(a.data(), a.size())
+                   , makeETag(a.data(), a.size() - 1));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,63 @@
+/**
+ * Copyright (c) 2021 Melown Technologies SE
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * *  Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * *  Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef vtsd_test_tmpfile_hpp_included_
+#define vtsd_test_tmpfile_hpp_included_
+
+#include <fstream>
+#include <string>
+
+#include <boost/noncopyable.hpp>
+#include <boost/filesystem.hpp>
+
+/** Unique temporary path removed (recursively) on destruction.
+ */
+class TemporaryPath : boost::noncopyable {
+public:
+    TemporaryPath()
+        : path_(boost::filesystem::temp_directory_path()
+                / boost::filesystem::unique_path("vtsd-test-%%%%-%%%%-%%%%"))
+    {}
+
+    ~TemporaryPath() {
+        boost::system::error_code ec;
+        boost::filesystem::remove_all(path_, ec);
+    }
+
+    const boost::filesystem::path& path() const { return path_; }
+
+    /** Writes given content to this path (as a regular file).
+     */
+    void write(const std::string &content) const {
+        std::ofstream f(path_.string(), std::ios::binary | std::ios::trunc);
+        f.write(content.data(), content.size());
+    }
+
+private:
+    boost::filesystem::path path_;
+};
+
+#endif // vtsd_test_tmpfile_hpp_included_